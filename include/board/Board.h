@@ -98,6 +98,21 @@ class Board {
      */
     virtual void clear() = 0;
 
+    /**
+     * @brief Exchanges the cells of this board with those of another board of the same size.
+     * Subclasses can exchange their storage instead of copying the cells one by one.
+     * @param other board to exchange the cells with
+     */
+    virtual void swap(Board *other) {
+        for (int y = 0; y < getHeight(); y++) {
+            for (int x = 0; x < getWidth(); x++) {
+                life_status_t status = getPos(x, y);
+                setPos(x, y, other->getPos(x, y));
+                other->setPos(x, y, status);
+            }
+        }
+    }
+
   protected:
     int width;
     int height;
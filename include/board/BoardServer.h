@@ -2,6 +2,7 @@
 #define BOARDSERVER_H
 
 #include "board/Board.h"
+#include "board/LoadBalancer.h"
 #include "misc/Log.h"
 #include "misc/Stopwatch.h"
 #include "net/BarrierMessage.h"
@@ -11,17 +12,45 @@
 #include "net/IPNetwork.h"
 #include "net/LogonMessage.h"
 #include "net/Message.h"
+#include "net/RegionGetMessage.h"
+#include "net/RegionSetMessage.h"
+#include "thread/Thread.h"
+#include <atomic>
 #include <bits/stdc++.h>
+#include <condition_variable>
+#include <mutex>
 #include <vector>
 
 struct ClientInfo {
     int client_id = -1;
     IPAddress *address = nullptr;
+    IPNetwork *net = nullptr; // network the client sends its requests to
     unsigned int last_sequence_number = 0;
+    unsigned int logon_sequence_number = 0;
+    short peer_port = 0; // port for halo messages from neighbours, 0 if the client takes none
     int last_completed_timestep = -1;
+    bool group_member = false; // the client is released from the barrier by the message to the multicast group
+};
+
+class BoardServer;
+
+/**
+ * Serves the requests arriving at one network of a BoardServer in a separate thread.
+ */
+class BoardServerWorker : public Thread {
+  public:
+    BoardServerWorker(BoardServer *server, IPNetwork *net) : server(server), net(net) {}
+    virtual ~BoardServerWorker() { cancel(); }
+    virtual void run();
+
+  private:
+    BoardServer *server;
+    IPNetwork *net;
 };
 
 class BoardServer {
+    friend class BoardServerWorker;
+
   public:
     /**
      * Constructor gets an IPNetwork over which communication will take
@@ -35,6 +64,20 @@ class BoardServer {
      */
     BoardServer(IPNetwork *net, size_t client_count, Board *board_read, Board *board_write, int timesteps = 0);
 
+    /**
+     * Constructor gets several IPNetworks, e.g. sockets sharing the same port, which are served by a
+     * thread each. Requests reading or writing the boards are handled concurrently, logons and barriers
+     * one after another.
+     *
+     * @param nets are pointers to network objects for communication
+     * @param clientcount is the number of clients which the server requires
+     * @param board_read is just a board
+     * @param board_write is just another board, but must be same size as the previous board
+     * @param timesteps is the amount simulation cycles
+     */
+    BoardServer(std::vector<IPNetwork *> nets, size_t client_count, Board *board_read, Board *board_write,
+                int timesteps = 0);
+
     /**
      * Frees all memory, which was allocated with new inside this class.
      */
@@ -44,39 +87,110 @@ class BoardServer {
 
     Stopwatch get_profiler() { return stopwatch; }
 
+    /**
+     * Clients normally keep their area and only write the rows their neighbours need to the server, the whole
+     * area is written after the last cycle. With full sync enabled, the whole area is written every cycle,
+     * e.g. to display the board while simulating.
+     *
+     * @param full_sync true, if clients have to write their whole area every cycle
+     */
+    void setFullSync(bool full_sync) { this->full_sync = full_sync; }
+
+    /**
+     * Clients report the time they need to calculate their area. Every few cycles they write their whole area,
+     * and the server moves rows from slow to fast clients, if their times differ.
+     *
+     * @param rebalance_interval cycles between rebalancing, 0 keeps the areas of the start
+     */
+    void setRebalanceInterval(int rebalance_interval) { this->rebalance_interval = rebalance_interval; }
+
+    /**
+     * Clients join a multicast group at logon, then a single message releases all of them from the barrier,
+     * unless their areas changed. Only networks supporting groups use it, the others reply to every client.
+     *
+     * @param group is the address and port of the group
+     */
+    void setMulticastGroup(const IPAddress &group) { this->group = group; }
+
   private:
-    IPNetwork *net;                    // network object used for communication
+    std::vector<IPNetwork *> nets;     // network objects used for communication, one thread each
     size_t client_count;               // amount of required clients
     Board *board_read;                 // read only for timestep n
     Board *board_write;                // write only for timestep n + 1
-    int timestep = 0;                  // current timestep
+    std::atomic<int> timestep{0};      // current timestep
     int timesteps;                     // how many timesteps we are going to simulate in total
     std::vector<ClientInfo *> clients; // list of clients
+    bool full_sync = false;            // clients write their whole area every cycle
+    int rebalance_interval = 0;        // cycles between rebalancing the areas, 0 if disabled
+    LoadBalancer balancer;             // block calculated by every client
+    std::atomic<int> arrivals{0};      // clients which completed the current timestep
+    std::mutex barrier_mutex;          // serializes logons and barriers
+    std::condition_variable finished;  // signaled, when the last timestep is completed
     Stopwatch stopwatch;
+    IPAddress group = IPAddress((short)0); // multicast group for barrier releases, the port is 0 if there is none
+    std::atomic<bool> registered{false};   // all clients logged on, the list of clients does not change anymore
+    bool peer_halos = false;               // the clients exchange the rows around their areas directly
+
+    static const int RECEIVE_BATCH = 32; // messages received at once
+
+    /**
+     * Receives and handles requests arriving at a network in batches, until the simulation is done.
+     */
+    void serve(IPNetwork *net);
+
+    /**
+     * Handles a single message, replies are queued on the network until the batch is done.
+     * The reply is built in reply_buffer, which holds MAX_MESSAGE_SIZE bytes.
+     */
+    void handle(IPNetwork *net, IPAddress &client_address, char *buffer, char *reply_buffer);
 
     /**
      * This function is called, when a client connects to the server for the first time.
-     * It stores the address of the client and determines the part of the board the client
-     * has to work on.
+     * It stores the address of the client. Once all clients are known, every client gets the part of
+     * the board it has to work on and the addresses of its neighbours.
      */
-    void logon(IPAddress *client_address, unsigned int login_sequence_number);
+    void logon(IPNetwork *net, IPAddress *client_address, unsigned int login_sequence_number, short peer_port);
+
+    /**
+     * Determines the part of the board a client has to work on.
+     */
+    void calculateArea(int client_id, int &start_x, int &start_y, int &end_x, int &end_y);
+
+    /**
+     * Checks if the clients write their whole areas in a cycle, instead of only the rows and columns their
+     * neighbours need.
+     */
+    bool isWholeAreaWritten(int cycle);
+
+    /**
+     * Sends the logon reply to a client, which tells it its area and its neighbours.
+     */
+    void notifyLogon(int client_id);
 
     /**
      * This function is the global barrier for interstepsynchronization. All clients must call
      * this function, before any of them gets a reply from the server. The reply can tell a client to
      * calculate the next timestep or inform him of the end of simulation.
+     * Arrivals are counted without the lock, only the last client of a timestep takes it to release all.
      */
-    void barrier(int client_id, unsigned int barrier_sequence_number, int completed_timestep);
+    void barrier(int client_id, unsigned int barrier_sequence_number, int completed_timestep, int64_t step_time,
+                 bool group_member);
 
     /**
      * This function tells a client, that it can continue to work or that the end of the simulation is reached.
+     * The reply is queued on the network of the client.
+     *
+     * @param group_release true, if the client gets the message to the multicast group instead of the reply
      */
-    void notify(int client_id);
+    void notify(int client_id, bool group_release);
 
     /**
-     * The more general notify, which sends the same notification to all clients.
+     * The more general notify, which sends the same notification to all clients. Members of the multicast
+     * group are released by a single message, if their areas stay the same and the simulation goes on.
+     *
+     * @param areas_changed true, if the clients were given new areas
      */
-    void notifyAll();
+    void notifyAll(bool areas_changed);
 };
 
 #endif
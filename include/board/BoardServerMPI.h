@@ -2,8 +2,11 @@
 #define BOARDSERVERMPI_H
 
 #include "board/Board.h"
+#include "board/LoadBalancer.h"
 #include "misc/Stopwatch.h"
+#include "net/CellPacker.h"
 #include <mpi.h>
+#include <vector>
 
 class BoardServerMPI {
   public:
@@ -24,6 +27,27 @@ class BoardServerMPI {
      */
     void start(Stopwatch *stopwatch = nullptr);
 
+    /**
+     * @brief Configures whether the clients load their initial area directly from the input file. If so, only the
+     * area outlines are sent to the clients instead of the whole initial area.
+     * @param clients_load_input true, if the clients load their initial area themselves
+     */
+    void set_clients_load_input(bool clients_load_input) { this->clients_load_input = clients_load_input; }
+
+    /**
+     * @brief Configures how often the rows are redistributed among the clients according to their step times.
+     * After every REBALANCE_INTERVAL cycles the clients get their bounds again, and their whole area, if it moved.
+     * @param rebalance_interval cycles between rebalancing, 0 keeps the areas of the start
+     */
+    void set_rebalance_interval(int rebalance_interval) { this->rebalance_interval = rebalance_interval; }
+
+    /**
+     * @brief Configures how many rows and columns surround the area of a client. The clients calculate that many
+     * generations on their own, before they exchange their areas with the server again.
+     * @param halo_depth generations between the exchanges, at least 1
+     */
+    void set_halo_depth(int halo_depth) { this->halo_depth = halo_depth; }
+
   private:
     void swap_boards();
 
@@ -35,9 +59,26 @@ class BoardServerMPI {
 
     void send_areas(bool first_pass);
 
-    void send_area(int rank, bool first_pass);
+    void send_bounds(int rank);
 
-    void barrier();
+    void send_area(int rank, bool whole_area);
+
+    /**
+     * @brief Gets the number of generations the clients calculate before the next exchange.
+     */
+    int get_generations();
+
+    bool is_rebalance_step();
+
+    void rebalance();
+
+    /**
+     * @brief Gets the buffer for packing and unpacking messages, it only grows, so that the cycles do not
+     * allocate memory.
+     * @param buffer_size minimum size of the buffer in bytes
+     * @return pointer to the buffer, valid until the next call.
+     */
+    char *get_pack_buffer(int buffer_size);
 
     void calculate_area(int rank, int &start_x, int &start_y, int &end_x, int &end_y);
 
@@ -45,6 +86,12 @@ class BoardServerMPI {
     Board *board_write;
     int timesteps;
     int current_timestep = 0;
+    bool clients_load_input = false;
+    int rebalance_interval = 0;
+    int halo_depth = 1;
+    LoadBalancer balancer;
+    std::vector<char> pack_buffer;
+    CellPacker cell_packer;
 };
 
 #endif
\ No newline at end of file
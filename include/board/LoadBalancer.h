@@ -0,0 +1,90 @@
+#ifndef LOADBALANCER_H
+#define LOADBALANCER_H
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Splits a board into a grid of blocks, one for each client, and moves the borders between the rows of the grid
+ * according to the measured speed of the clients, so that all of them need about the same time for a cycle.
+ *
+ * The grid is chosen so that the blocks have as few cells at their borders as possible, since those are exchanged
+ * every cycle. Blocks spanning whole rows are preferred, their left and right borders wrap around to themselves.
+ * Block ids count along the rows of the grid: block = grid_row * grid_columns + grid_column.
+ */
+class LoadBalancer {
+  public:
+    LoadBalancer() : LoadBalancer(0, 0, 0) {}
+
+    /**
+     * Distributes the rows and columns evenly, if they can not be distributed evenly, the first rows and columns
+     * of the grid get a row or column more.
+     *
+     * @param width is the width of the board
+     * @param height is the height of the board
+     * @param blocks is the amount of clients
+     */
+    LoadBalancer(int width, int height, int blocks);
+
+    /**
+     * Chooses the grid for a number of blocks, every block gets at least one row and column, if possible.
+     *
+     * @param grid_rows is set to the number of rows of the grid
+     * @param grid_columns is set to the number of columns of the grid
+     * @return false, if the blocks do not fit into the board, then every block gets rows only
+     */
+    static bool chooseGrid(int width, int height, int blocks, int &grid_rows, int &grid_columns);
+
+    /**
+     * @brief Gets the part of the board a block covers, the end is not part of it.
+     */
+    void getArea(int block, int &start_x, int &start_y, int &end_x, int &end_y);
+
+    /**
+     * @brief Gets the block in the same column of the grid, the given number of grid rows below a block.
+     * Wraps around the borders of the grid.
+     */
+    int getNeighbour(int block, int grid_rows_below);
+
+    int getGridRows() { return grid_rows; }
+
+    int getGridColumns() { return grid_columns; }
+
+    /**
+     * Adds the time a client needed to calculate its block for a cycle.
+     *
+     * @param block is the block of the client
+     * @param step_time is the time in microseconds
+     */
+    void addStepTime(int block, int64_t step_time);
+
+    /**
+     * Moves the borders between the rows of the grid towards a share of the board rows, which fits the speed
+     * measured since the last call. A row of the grid is as fast as its slowest block.
+     * The grid is only changed, if the slowest row needs noticeably longer than the fastest one.
+     *
+     * @return true, if a block was changed
+     */
+    bool rebalance();
+
+    /**
+     * @brief Checks if a block was changed by the last call of rebalance().
+     */
+    bool hasMoved(int block) {
+        int band = block / grid_columns;
+        return starts[band] != previous_starts[band] || starts[band + 1] != previous_starts[band + 1];
+    }
+
+  private:
+    static constexpr double TOLERANCE = 0.1; // step times may differ by this fraction without rebalancing
+
+    int rows;
+    int grid_rows = 0;
+    int grid_columns = 1;
+    std::vector<int> starts;          // first board row of every grid row, followed by the height of the board
+    std::vector<int> previous_starts; // starts before the last rebalancing
+    std::vector<int> column_starts;   // first board column of every grid column, followed by the board width
+    std::vector<int64_t> step_times;  // summed step times of every block since the last rebalancing
+};
+
+#endif // LOADBALANCER_H
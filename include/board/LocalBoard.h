@@ -2,6 +2,7 @@
 #define LOCALBOARD_H
 
 #include <algorithm>
+#include <istream>
 #include <string>
 #include <sys/types.h>
 #include <vector>
@@ -45,24 +46,83 @@ class LocalBoard : public Board {
     life_status_t getPos(int x, int y) override;
 
     /**
-     * Exports this board to output file.
+     * Exports this board to output file. Files ending in ".mc" are written in the macrocell format,
+     * all others as RLE.
      *
      * @return true, if successful, else otherwise.
      */
     bool exportAll(std::string destFileName) override;
 
     /**
-     * Imports to this board from output file.
+     * Imports to this board from output file. Files ending in ".mc" are read in the macrocell format, the board
+     * takes the stored board size or the bounding box of the pattern, unless it is too large to be held in memory.
      *
      * @return true, if successful, else otherwise.
      */
     bool importAll(std::string sourceFileName) override;
 
+    /**
+     * Fills this board with a window of a pattern file without loading the rest of it. The window has the size
+     * of this board and wraps around the pattern borders. RLE files are read using their row index if there is a
+     * valid one, else the whole file is imported. Macrocell files are rasterized only inside the window.
+     *
+     * @param sourceFileName is the pattern file
+     * @param origin_x is the pattern column of the left border of the window
+     * @param origin_y is the pattern row of the upper border of the window
+     * @return true, if successful, else otherwise.
+     */
+    bool importWindow(std::string sourceFileName, int origin_x, int origin_y);
+
+    /**
+     * Reads the board size from the header of a pattern file.
+     *
+     * @return true, if successful, else otherwise.
+     */
+    static bool readSize(std::string sourceFileName, int &x_size, int &y_size);
+
+    /**
+     * Writes a row index for a pattern file to sourceFileName + ".idx". It maps every row to the byte offset
+     * its data starts at, which allows importWindow() to read only the rows it needs.
+     *
+     * @return true, if successful, else otherwise.
+     */
+    static bool buildIndex(std::string sourceFileName);
+
+    /**
+     * Checks if a pattern file has a row index which is up to date.
+     *
+     * @return true, if a valid index exists, else otherwise.
+     */
+    static bool hasIndex(std::string sourceFileName);
+
     /**
      * Performs one step on this board.
      */
     void step() override;
 
+    /**
+     * Calculates the next generation of the cells in a region, the board keeps the current generation until
+     * completeStep() is called. This allows to calculate the parts of a board, whose neighbours are known,
+     * while others are still being received.
+     *
+     * @param start_x, start_y, end_x, end_y the region, the end is not part of it
+     */
+    void stepRegion(int start_x, int start_y, int end_x, int end_y);
+
+    /**
+     * Calculates the next generation of the cells at the border of a region, see stepRegion().
+     *
+     * @param start_x, start_y, end_x, end_y the region, the end is not part of it
+     * @param thickness is the number of rows and columns of the border
+     */
+    void stepFrame(int start_x, int start_y, int end_x, int end_y, int thickness = 1);
+
+    /**
+     * Replaces the current generation with the one calculated by stepRegion(). Cells outside of the
+     * calculated regions are undefined afterwards.
+     */
+    void completeStep();
+
     /**
      * @brief Get the board width.
      * @return board width.
@@ -80,6 +140,19 @@ class LocalBoard : public Board {
      */
     void clear() override;
 
+    /**
+     * @brief Exchanges the cells with another board of the same size in constant time, if it is a LocalBoard too.
+     * @param other board to exchange the cells with
+     */
+    void swap(Board *other) override;
+
+    /**
+     * @brief Copies the cells of a region from another board of the same size.
+     * @param source board to copy the cells from
+     * @param start_x, start_y, end_x, end_y the region, the end is not part of it
+     */
+    void copyRegion(LocalBoard *source, int start_x, int start_y, int end_x, int end_y);
+
   protected:
     /**
      * Sets an element to a life status. Invalid inputs will be discarded.
@@ -98,8 +171,58 @@ class LocalBoard : public Board {
      */
     enum life_status_t getPosRaw(int x, int y);
 
+    /**
+     * Parses the RLE header line of a pattern, skipping leading comments.
+     * Leaves the stream positioned at the first line of the pattern data.
+     *
+     * @return true, if a valid size was read, else otherwise.
+     */
+    static bool parseRLEHeader(std::istream &boardFile, int &x_size, int &y_size);
+
+    /**
+     * Finds the '!' terminating the pattern, which is not part of a comment.
+     *
+     * @param begin is the first character of the data
+     * @param end is one past the last character of the data
+     * @return the position of the terminator, or end if there is none
+     */
+    static const char *findPatternEnd(const char *begin, const char *end);
+
+    /**
+     * Finds the next row terminator, which is not part of a comment.
+     *
+     * @param line_start is the start of the line containing cursor, or a position after a row terminator in it
+     * @param cursor is the first character, which may be the terminator
+     * @param end is one past the last character of the data
+     * @return the position of the terminator, or end if there is none
+     */
+    static const char *findRowTerminator(const char *line_start, const char *cursor, const char *end);
+
+    /**
+     * Counts how many rows are terminated by RLE data, i.e. the sum of all '$' run counts.
+     * Comments are skipped like decodeRLE() does.
+     *
+     * @param begin is the first character of the data
+     * @param end is one past the last character of the data
+     * @return the amount of terminated rows
+     */
+    static int countRLERows(const char *begin, const char *end);
+
+    /**
+     * Decodes RLE data into the field, starting at the beginning of a row. Only alive cells are written,
+     * the field has to be cleared beforehand. Cells outside the board are discarded.
+     *
+     * @param begin is the first character of the data, must be the start of a row
+     * @param end is one past the last character of the data
+     * @param row is the row the data starts in
+     */
+    void decodeRLE(const char *begin, const char *end, int row);
+
     // 1-Dimensional representation of the field (y * width + x, to access (x,y))
     std::vector<enum life_status_t> field;
+
+    // the field of the next step, kept between steps to avoid allocating it every time
+    std::vector<enum life_status_t> next_field;
 };
 
 #endif
\ No newline at end of file
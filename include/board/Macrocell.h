@@ -0,0 +1,119 @@
+#ifndef MACROCELL_H
+#define MACROCELL_H
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "board/Board.h"
+
+/**
+ * A node of a hashed quadtree. Nodes of level 3 are leaves holding an 8x8 block of cells,
+ * all other nodes reference four children of the next lower level.
+ */
+struct MacrocellNode {
+    int level = 0;
+    uint64_t cells = 0;             // level 3 only, bit (y * 8 + x) is set for alive cells
+    int children[4] = {0, 0, 0, 0}; // nw, ne, sw, se as node indices, 0 is the empty node
+};
+
+/**
+ * A pattern in the macrocell format, stored as a hashed quadtree where equal subtrees are shared.
+ * The root node covers the area from 0,0 to 2^level, 2^level.
+ */
+class Macrocell {
+  public:
+    Macrocell();
+
+    /**
+     * Reads a pattern from a macrocell file.
+     *
+     * @param sourceFileName is the file to read
+     * @return true, if successful, else otherwise.
+     */
+    bool read(std::string sourceFileName);
+
+    /**
+     * Writes the pattern to a macrocell file.
+     *
+     * @param destFileName is the file to write
+     * @return true, if successful, else otherwise.
+     */
+    bool write(std::string destFileName);
+
+    /**
+     * Builds the quadtree from the content of a board.
+     *
+     * @param board is the board to read
+     */
+    void fromBoard(Board *board);
+
+    /**
+     * Writes a window of an area of the pattern into a board, the window has the size of the board and wraps
+     * around the borders of the area. Only alive cells are written, the board should be cleared beforehand.
+     *
+     * @param board is the board to write to
+     * @param origin_x is the column of the left border of the window, relative to the area
+     * @param origin_y is the row of the upper border of the window, relative to the area
+     * @param area_x is the pattern column of the left border of the area
+     * @param area_y is the pattern row of the upper border of the area
+     * @param area_width is the width of the area
+     * @param area_height is the height of the area
+     */
+    void rasterize(Board *board, int64_t origin_x, int64_t origin_y, int64_t area_x, int64_t area_y,
+                   int64_t area_width, int64_t area_height);
+
+    /**
+     * Calculates the smallest rectangle containing all alive cells.
+     *
+     * @return false, if the pattern is empty, else true
+     */
+    bool boundingBox(int64_t &start_x, int64_t &start_y, int64_t &end_x, int64_t &end_y);
+
+    /**
+     * @brief Gets the board size stored in the file, if there was one.
+     * @return true, if the size is known, else otherwise.
+     */
+    bool getBoardSize(int64_t &width, int64_t &height);
+
+    /**
+     * @brief Gets the level of the root node.
+     * @return level of the root, the pattern covers 2^level * 2^level cells.
+     */
+    int getLevel();
+
+    /**
+     * @brief Gets all nodes, children always come before their parents.
+     * @return list of nodes, index 0 is the empty node.
+     */
+    const std::vector<MacrocellNode> &getNodes() { return nodes; }
+
+    /**
+     * @brief Gets the index of the root node.
+     * @return root node index, 0 if the pattern is empty.
+     */
+    int getRoot() { return root; }
+
+  private:
+    void rasterizeNode(Board *board, int node, int level, int64_t node_x, int64_t node_y, int64_t start_x,
+                       int64_t start_y, int64_t end_x, int64_t end_y, int64_t board_x, int64_t board_y);
+
+    int writeNode(std::ostream &mcFile, int node, std::vector<int> &numbers, int &next_number);
+
+    int addLeaf(uint64_t cells);
+
+    int addNode(int level, int nw, int ne, int sw, int se);
+
+    std::vector<MacrocellNode> nodes;
+    std::map<uint64_t, int> leaf_ids;                            // hash-consing of leaves
+    std::map<std::tuple<int, int, int, int, int>, int> node_ids; // hash-consing of inner nodes
+    int root = 0;
+    int root_level = 3;
+    int64_t board_width = -1;
+    int64_t board_height = -1;
+};
+
+#endif // MACROCELL_H
@@ -0,0 +1,75 @@
+#ifndef HALOEXCHANGE_H
+#define HALOEXCHANGE_H
+
+#include "board/LocalBoard.h"
+#include "net/HaloMessage.h"
+#include "net/IPAddress.h"
+#include "net/IPNetwork.h"
+#include "thread/Thread.h"
+#include <mutex>
+#include <vector>
+
+/**
+ * Receives the rows surrounding the area of a client directly from the neighbouring clients.
+ * A separate thread answers the halo messages of the neighbours, while the client calculates.
+ *
+ * A neighbour can be at most one cycle ahead, since it needs the rows of this client for the cycle after.
+ * So there are two slots for each surrounding row, used alternately by even and odd cycles.
+ * The rows are told apart by the border of the neighbour they come from, not by their position on the board,
+ * so the areas may change between cycles.
+ *
+ * The neighbours hand over their rows before they arrive at the barrier, so the rows of a cycle are complete
+ * once the barrier released the clients. A neighbour, whose rows were not answered in time, writes them to the
+ * server instead.
+ */
+class HaloExchange : public Thread {
+  public:
+    /**
+     * @param peer_net is the network the neighbours send their halo messages to
+     * @param width is the width of the area, which is the width of the whole board
+     */
+    HaloExchange(IPNetwork *peer_net, int width);
+
+    /**
+     * Stops receiving halo messages.
+     */
+    virtual ~HaloExchange();
+
+    /**
+     * Receives and answers halo messages until the thread is cancelled.
+     */
+    virtual void run();
+
+    /**
+     * Takes a surrounding row of a cycle and writes it to the first or last row of a board, starting at column 1.
+     * Must be called after the barrier of the cycle, the slot of the row is used for a later cycle afterwards.
+     *
+     * @param timestep is the cycle the row was calculated in
+     * @param lower is true for the row below the area, false for the one above
+     * @param board is the board of the client, its area starts at 1,1
+     * @return false, if the row did not arrive completely, the board is not changed then
+     */
+    bool take(int timestep, bool lower, LocalBoard *board);
+
+  private:
+    struct Slot {
+        int timestep;                // cycle the slot is waiting for
+        LocalBoard *row;             // received cells
+        std::vector<bool> fragments; // start columns of the received parts, repeated messages are ignored
+        int received_cells = 0;
+    };
+
+    /**
+     * Stores the cells of a halo message in the slots of the rows it belongs to.
+     *
+     * @return false, if the message did not fit the area
+     */
+    bool store(HaloMessage *message);
+
+    IPNetwork *peer_net;
+    int width;
+    Slot slots[2][2]; // [timestep % 2][upper, lower]
+    std::mutex mutex;
+};
+
+#endif // HALOEXCHANGE_H
@@ -2,13 +2,21 @@
 #define LIFECLIENT_H
 
 #include "board/LocalBoard.h"
+#include "client/HaloExchange.h"
 #include "misc/Log.h"
 #include "net/BarrierMessage.h"
 #include "net/BoardGetMessage.h"
 #include "net/BoardSetMessage.h"
+#include "net/HaloMessage.h"
 #include "net/IPAddress.h"
 #include "net/IPNetwork.h"
 #include "net/LogonMessage.h"
+#include "net/RegionGetMessage.h"
+#include "net/RegionSetMessage.h"
+#include <chrono>
+#include <stdint.h>
+#include <string>
+#include <vector>
 
 /*
  * This class represents a LifeClient which connects to a boardserver, and then
@@ -26,6 +34,22 @@ class LifeClient {
      */
     LifeClient(IPNetwork *net, const char *servername, short port);
 
+    /**
+     * Lets the client load its initial area directly from a pattern file shared with the server,
+     * instead of reading it from the server. Must be called before start().
+     *
+     * @param input_path is the pattern file the server was started with
+     */
+    void setInput(std::string input_path) { this->input_path = input_path; }
+
+    /**
+     * Lets the client exchange the rows surrounding its area directly with its neighbours, instead of
+     * through the server. Must be called before start().
+     *
+     * @param peer_net is a network bound to a port, on which the neighbours can reach this client
+     */
+    void setPeerNetwork(IPNetwork *peer_net) { this->peer_net = peer_net; }
+
     virtual ~LifeClient();
 
     /**
@@ -41,17 +65,133 @@ class LifeClient {
     void loop();
 
   private:
-    unsigned int sequence_number;
+    // a part of a region, which fits into a single message
+    struct Fragment {
+        int start_x, start_y, end_x, end_y;
+    };
+
+    static const size_t REQUEST_WINDOW = 16; // requests in flight while reading or writing a region
+    static const int HALO_TIMEOUT = 1000;     // milliseconds a neighbour may take to answer a halo message
+
+    unsigned int sequence_number = 0;
     int client_id;
     int timestep = 0;
     int timesteps;
     int x1, x2, y1, y2; // outlines the part of the board which should be calculated by the client
+    int board_width, board_height;
+    bool full_sync = false;
+    int rebalance_interval = 0; // the server may move the area after every rebalance_interval cycles
+    int64_t step_time = 0;      // microseconds the last cycle took to calculate
+    std::string input_path;
+    LocalBoard *board = nullptr;    // the area and its surroundings, kept between cycles
+    LocalBoard *uploaded = nullptr; // the cells of the board as the server knows them
+    bool area_uploaded = false;     // the server got the whole area in the last cycle
     IPNetwork *net;
     IPAddress server;
+    IPNetwork *peer_net = nullptr;
+    HaloExchange *halo_exchange = nullptr; // receives the surroundings from the neighbours, if they take part
+    bool surroundings_pending = false;     // the surroundings for the next cycle were requested, but not received
+    IPAddress upper_peer, lower_peer;
+    bool group_member = false; // the server releases the client from the barrier through a multicast group
 
+    // reused by every request, so that the cycles do not allocate memory
+    alignas(8) char request_buffer[MAX_MESSAGE_SIZE];
+    std::vector<Fragment> fragments; // parts of the region which is currently read or written
+    size_t submitted_fragments = 0;  // fragments, whose read request was already sent
+    std::vector<char> answer_buffers;
+    std::vector<int> handles;
+
+    /**
+     * Calculates the next cycle of the area and writes the changes the server needs.
+     * The inner cells are calculated before the pending surroundings are received.
+     */
     void makeStep();
+
+    /**
+     * Requests the surroundings of the area, which were calculated by other clients, without waiting for them.
+     */
+    void requestSurroundings();
+
+    /**
+     * Waits for the surroundings requested by requestSurroundings() and stores them in the board.
+     */
+    void receiveSurroundings();
+
+    /**
+     * Copies the outer columns of the area to the opposite border of the board, for areas spanning whole rows.
+     */
+    void wrapColumns(int start_y, int end_y);
+
+    /**
+     * Takes a new area from the server after rebalancing, and reads it with its surroundings.
+     */
+    void moveArea(int start_x, int start_y, int end_x, int end_y);
+
+    /**
+     * Writes a region of the area to the server and remembers the cells written.
+     *
+     * @param changes_only true, if the server knows the cells of the region from the last cycle,
+     * then only the cells which changed since then are sent, if that is smaller
+     */
+    void uploadRegion(int start_x, int start_y, int end_x, int end_y, bool changes_only);
+
+    /**
+     * Remembers the whole board as known to the server, after it was read from it.
+     */
+    void rememberArea();
+
+    /**
+     * Sends a row of the area to a neighbour, split into as many messages as needed. If the neighbour does not
+     * answer in time, the row is written to the server instead, where the neighbour reads it from.
+     *
+     * @param upper_border true for the first row of the area, false for the last one
+     */
+    void sendHalo(const IPAddress &peer, int row, bool upper_border);
     life_status_t getRemotePos(int x, int y);
     bool setRemotePos(int x, int y, life_status_t status);
+
+    /**
+     * Reads a region of the remote board into a local board, split into as many messages as needed.
+     * The local board position of a remote cell is its remote position minus board_x, board_y.
+     */
+    bool getRemoteRegion(LocalBoard *board, int board_x, int board_y, int start_x, int start_y, int end_x,
+                         int end_y);
+
+    /**
+     * Writes a region of a local board to the remote board, split into as many messages as needed.
+     * The local board position of a remote cell is its remote position minus board_x, board_y.
+     * With a reference board, which holds the remote cells at the same positions, only the changes are sent.
+     */
+    bool setRemoteRegion(LocalBoard *board, int board_x, int board_y, int start_x, int start_y, int end_x,
+                         int end_y, LocalBoard *reference = nullptr);
+
+    /**
+     * Sends the read requests for the first REQUEST_WINDOW fragments.
+     */
+    void submitGetRequests();
+    void submitGetRequest(size_t index);
+
+    /**
+     * Stores the answers of the read requests for all fragments in a local board, sending the remaining
+     * requests as answers arrive. The local board position of a remote cell is its remote position minus
+     * board_x, board_y.
+     */
+    bool receiveGetReplies(LocalBoard *board, int board_x, int board_y);
+
+    /**
+     * Splits a region into parts, which fit into a single message each, and appends them to fragments.
+     */
+    void splitRegion(int start_x, int start_y, int end_x, int end_y);
+
+    /**
+     * Makes room for the answers and handles of the given number of requests in flight.
+     */
+    void reserveBuffers(size_t count);
+
+    /**
+     * Calculates the size of the parts a region is split into, so that each fits into a single message.
+     */
+    void getFragmentSize(int width, int height, int &fragment_width, int &fragment_height);
     unsigned int getNextSequenceNumber();
 };
 
@@ -2,7 +2,12 @@
 #define LIFECLIENTMPI_H
 
 #include "board/LocalBoard.h"
+#include "net/CellPacker.h"
+#include <chrono>
 #include <mpi.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
 
 class LifeClientMPI {
   public:
@@ -10,8 +15,9 @@ class LifeClientMPI {
      * @brief Creates a client which will help a server simulate the Game of Life by simulating portions of the overall
      * board.
      * @param root_rank rank / id of the server, usually 0
+     * @param input_path if not empty, the initial area is loaded from this file instead of being received
      */
-    LifeClientMPI(int root_rank);
+    LifeClientMPI(int root_rank, std::string input_path = "");
 
     virtual ~LifeClientMPI();
 
@@ -25,16 +31,57 @@ class LifeClientMPI {
 
     void send_area();
 
-    void receive_area(bool first_pass);
+    /**
+     * @brief Receives the bounds of the area, and creates the board for it, if they changed.
+     * @return true, if the board was created, so that the whole area has to be received.
+     */
+    bool receive_bounds();
+
+    /**
+     * @brief Receives the area and its surroundings.
+     */
+    void receive_area();
+
+    /**
+     * @brief Remembers the cells of the board, so that only the changes to them have to be sent.
+     * @param known_to_server true, if the server has the same cells
+     */
+    void remember_area(bool known_to_server);
 
-    void barrier();
+    /**
+     * @brief Starts receiving the surroundings of the area, while the next cycle is calculated.
+     */
+    void request_surroundings();
+
+    /**
+     * @brief Waits for the surroundings requested by request_surroundings() and stores them in the board.
+     */
+    void wait_surroundings();
+
+    /**
+     * @brief Gets the buffer for packing and unpacking messages, it only grows, so that the cycles do not
+     * allocate memory.
+     * @param buffer_size minimum size of the buffer in bytes
+     * @return pointer to the buffer, valid until the next call.
+     */
+    char *get_pack_buffer(int buffer_size);
 
     int timesteps;
+    int rebalance_interval = 0;
+    int halo_depth = 1; // rows and columns around the area, the generations calculated between the exchanges
+    int64_t step_time = 0; // microseconds the last cycle took to calculate
     int current_timestep = 0;
     int root_rank = 0;
+    std::string input_path;
     int start_x, start_y = -1;
     int end_x, end_y = -1;
     LocalBoard *board = nullptr;
+    LocalBoard *sent = nullptr; // the area as it was sent last, the server keeps it until the next exchange
+    bool area_sent = false;
+    std::vector<char> pack_buffer;
+    CellPacker cell_packer;
+    std::vector<char> surroundings_buffer; // filled by the pending receive of the surroundings
+    MPI_Request surroundings_request = MPI_REQUEST_NULL;
 };
 
 #endif
\ No newline at end of file
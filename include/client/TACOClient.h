@@ -8,7 +8,7 @@ class TACOClient {
   public:
     TACOClient(int start_x, int start_y, int end_x, int end_y, taco::ObjectPtr<LocalBoard> server_board)
         : start_x(start_x), start_y(start_y), end_x(end_x), end_y(end_y),
-          client_board(end_x - start_x, (end_y - start_y) + 2), server_board(server_board) {}
+          client_board((end_x - start_x) + 2, (end_y - start_y) + 2), server_board(server_board) {}
 
     ~TACOClient() {}
 
@@ -16,11 +16,11 @@ class TACOClient {
         // clear local board
         client_board.clear();
 
-        // loop through the assigned area + upper and lower border points and read values from server into our client
-        // local board.
+        // loop through the assigned area + surrounding border points including the corners and read values from
+        // server into our client local board, the borders wrap around to the end of the local board.
         // x and y are server_board positions while local_x and local_y are client board positions.
         for (int y = start_y - 1; y < end_y + 1; y++) {
-            for (int x = start_x; x < end_x; x++) {
+            for (int x = start_x - 1; x < end_x + 1; x++) {
                 int local_x = x - start_x;
                 int local_y = y - start_y;
                 life_status_t remote_state = server_board->invoke(taco::m2f(&LocalBoard::getPos, x, y));
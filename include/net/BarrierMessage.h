@@ -2,6 +2,7 @@
 #define BARRIERMESSAGE_H
 
 #include "net/Message.h"
+#include <stdint.h>
 
 class BarrierMessage : public Message {
   private:
@@ -11,31 +12,62 @@ class BarrierMessage : public Message {
   public:
     /**
      * @brief Helper function to create a 'board get' request message.
-     * @return unmanaged pointer to the created message.
+     * @param buffer memory of at least MAX_MESSAGE_SIZE bytes, the message is constructed in it
+     * @param step_time time in microseconds the client needed to calculate its area
+     * @param group_member true, if the client receives the release of the barrier from the multicast group
+     * @return pointer to the created message, which lives in the buffer.
      */
-    static BarrierMessage *createRequest(unsigned int sequence_number, int client_id, int finished_timestep) {
-        BarrierMessage *message = new BarrierMessage(sequence_number);
+    static BarrierMessage *createRequest(void *buffer, unsigned int sequence_number, int client_id,
+                                         int finished_timestep, int64_t step_time, bool group_member = false) {
+        BarrierMessage *message = new (buffer) BarrierMessage(sequence_number);
         message->client_id = client_id;
         message->finished_timestep = finished_timestep;
+        message->step_time = step_time;
+        message->group_member = group_member;
         message->toRequest();
         return message;
     };
 
     /**
      * @brief Helper function to create a 'board get' reply message.
-     * @return unmanaged pointer to the created message.
+     * @param buffer memory of at least MAX_MESSAGE_SIZE bytes, the message is constructed in it
+     * @param start_x, start_y, end_x, end_y the area the client calculates in the next cycle
+     * @return pointer to the created message, which lives in the buffer.
      */
-    static BarrierMessage *createReply(unsigned int sequence_number, int client_id) {
-        BarrierMessage *message = new BarrierMessage(sequence_number);
+    static BarrierMessage *createReply(void *buffer, unsigned int sequence_number, int client_id, int start_x,
+                                       int start_y, int end_x, int end_y) {
+        BarrierMessage *message = new (buffer) BarrierMessage(sequence_number);
         message->client_id = client_id;
         message->continueNext = true;
+        message->start_x = start_x;
+        message->start_y = start_y;
+        message->end_x = end_x;
+        message->end_y = end_y;
+        message->toReply();
+        return message;
+    };
+
+    /**
+     * @brief Helper function to create the release of all clients, which is sent to the multicast group.
+     * @param buffer memory of at least MAX_MESSAGE_SIZE bytes, the message is constructed in it
+     * @param finished_timestep the cycle all clients completed, it is the sequence number of the message
+     * @return pointer to the created message, which lives in the buffer. Its area is empty, the clients keep theirs.
+     */
+    static BarrierMessage *createRelease(void *buffer, int finished_timestep) {
+        BarrierMessage *message = new (buffer) BarrierMessage((unsigned int)finished_timestep);
+        message->finished_timestep = finished_timestep;
+        message->continueNext = true;
         message->toReply();
         return message;
     };
 
     int client_id = -1;
     int finished_timestep = -1;
+    int64_t step_time = 0;
+    bool group_member = false;
     bool continueNext = false;
+    // the area may change, when the server balances the load of the clients
+    int start_x = 0, start_y = 0, end_x = 0, end_y = 0;
 };
 
 #endif
\ No newline at end of file
@@ -12,10 +12,11 @@ class BoardGetMessage : public Message {
   public:
     /**
      * @brief Helper function to create a 'board get' request message.
-     * @return unmanaged pointer to the created message.
+     * @param buffer memory of at least MAX_MESSAGE_SIZE bytes, the message is constructed in it
+     * @return pointer to the created message, which lives in the buffer.
      */
-    static BoardGetMessage *createRequest(unsigned int sequence_number, int x, int y) {
-        BoardGetMessage *message = new BoardGetMessage(sequence_number);
+    static BoardGetMessage *createRequest(void *buffer, unsigned int sequence_number, int x, int y) {
+        BoardGetMessage *message = new (buffer) BoardGetMessage(sequence_number);
         message->pos_x = x;
         message->pos_y = y;
         message->toRequest();
@@ -24,10 +25,11 @@ class BoardGetMessage : public Message {
 
     /**
      * @brief Helper function to create a 'board get' reply message.
-     * @return unmanaged pointer to the created message.
+     * @param buffer memory of at least MAX_MESSAGE_SIZE bytes, the message is constructed in it
+     * @return pointer to the created message, which lives in the buffer.
      */
-    static BoardGetMessage *createReply(unsigned int sequence_number, int x, int y, Board *board) {
-        BoardGetMessage *message = new BoardGetMessage(sequence_number);
+    static BoardGetMessage *createReply(void *buffer, unsigned int sequence_number, int x, int y, Board *board) {
+        BoardGetMessage *message = new (buffer) BoardGetMessage(sequence_number);
         message->pos_x = x;
         message->pos_y = y;
         message->state = board->getPos(x, y);
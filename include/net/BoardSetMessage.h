@@ -12,10 +12,12 @@ class BoardSetMessage : public Message {
   public:
     /**
      * @brief Helper function to create a 'board get' request message.
-     * @return unmanaged pointer to the created message.
+     * @param buffer memory of at least MAX_MESSAGE_SIZE bytes, the message is constructed in it
+     * @return pointer to the created message, which lives in the buffer.
      */
-    static BoardSetMessage *createRequest(unsigned int sequence_number, int x, int y, life_status_t state) {
-        BoardSetMessage *message = new BoardSetMessage(sequence_number);
+    static BoardSetMessage *createRequest(void *buffer, unsigned int sequence_number, int x, int y,
+                                          life_status_t state) {
+        BoardSetMessage *message = new (buffer) BoardSetMessage(sequence_number);
         message->pos_x = x;
         message->pos_y = y;
         message->state = state;
@@ -25,10 +27,11 @@ class BoardSetMessage : public Message {
 
     /**
      * @brief Helper function to create a 'board get' reply message.
-     * @return unmanaged pointer to the created message.
+     * @param buffer memory of at least MAX_MESSAGE_SIZE bytes, the message is constructed in it
+     * @return pointer to the created message, which lives in the buffer.
      */
-    static BoardSetMessage *createReply(unsigned int sequence_number) {
-        BoardSetMessage *message = new BoardSetMessage(sequence_number);
+    static BoardSetMessage *createReply(void *buffer, unsigned int sequence_number) {
+        BoardSetMessage *message = new (buffer) BoardSetMessage(sequence_number);
         message->confirmed = true;
         message->toReply();
         return message;
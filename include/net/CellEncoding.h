@@ -0,0 +1,95 @@
+#ifndef CELLENCODING_H
+#define CELLENCODING_H
+
+#include <stddef.h>
+
+#include "board/Board.h"
+
+/**
+ * Converts rectangular areas of a board into a compact byte representation for transfers and back.
+ * Cells are visited row by row. The first byte tells the format, whichever is the smallest for an area is used:
+ *  - bitmap: one bit per cell, set for alive cells
+ *  - runs: the lengths of alternating runs of dead and alive cells, starting with dead cells
+ *  - sparse: the number of dead cells before every alive cell
+ * Lengths are stored as variable length integers, 7 bits per byte.
+ *
+ * An area can also be encoded as the difference to a reference board, e.g. the previous generation known to
+ * the receiver. Then the cells are set, which differ from the reference, so areas which hardly change become
+ * small. The receiver needs the same reference to decode them.
+ */
+class CellEncoding {
+  public:
+    /**
+     * @brief Gets the maximum amount of bytes needed to encode an area, the bitmap is never exceeded.
+     * @param cells number of cells in the area
+     * @return maximum size of the encoded area in bytes
+     */
+    static size_t encodedSize(size_t cells) { return 1 + (cells + 7) / 8; }
+
+    /**
+     * @brief Gets the amount of cells, which are guaranteed to fit into a buffer.
+     * @param size of the buffer in bytes
+     * @return number of cells
+     */
+    static size_t maxCells(size_t size) { return size > 0 ? (size - 1) * 8 : 0; }
+
+    /**
+     * Encodes an area of a board.
+     *
+     * @param board is the board to read from
+     * @param start_x is the left border of the area
+     * @param start_y is the upper border of the area
+     * @param width is the width of the area
+     * @param height is the height of the area
+     * @param data is the buffer the encoded area is written to, must hold encodedSize(width * height) bytes
+     * @param reference is the board the difference is encoded to, or nullptr to encode the cells themselves.
+     * The cells themselves are encoded nevertheless, if the difference is not smaller.
+     * @return the amount of bytes written
+     */
+    static size_t encode(Board *board, int start_x, int start_y, int width, int height, unsigned char *data,
+                         Board *reference = nullptr);
+
+    /**
+     * Decodes an area into a board.
+     *
+     * @param board is the board to write to
+     * @param start_x is the left border of the area
+     * @param start_y is the upper border of the area
+     * @param width is the width of the area
+     * @param height is the height of the area
+     * @param data is the encoded area
+     * @param size is the amount of bytes in data
+     * @param reference is the board the difference was encoded to, it may be the board itself
+     * @return true, if data held the whole area, else false, also for differences without a reference
+     */
+    static bool decode(Board *board, int start_x, int start_y, int width, int height, const unsigned char *data,
+                       size_t size, Board *reference = nullptr);
+
+  private:
+    enum cell_format_t : unsigned char { bitmap, runs, sparse };
+
+    static const unsigned char DIFFERENCE = 0x80; // set in the format byte, if the difference is encoded
+
+    static size_t encodeCells(Board *board, int start_x, int start_y, int width, int height, unsigned char *data,
+                              Board *reference);
+
+    static bool isAlive(Board *board, Board *reference, int x, int y) {
+        bool alive = board->getPos(x, y) == life_status_t::alive;
+        return reference != nullptr ? alive != (reference->getPos(x, y) == life_status_t::alive) : alive;
+    }
+
+    static void setAlive(Board *board, Board *reference, int x, int y, bool alive) {
+        if (reference != nullptr && reference->getPos(x, y) == life_status_t::alive) {
+            alive = !alive;
+        }
+        board->setPos(x, y, alive ? life_status_t::alive : life_status_t::dead);
+    }
+
+    static size_t lengthSize(size_t length);
+
+    static size_t writeLength(size_t length, unsigned char *data);
+
+    static bool readLength(const unsigned char *data, size_t size, size_t &position, size_t &length);
+};
+
+#endif // CELLENCODING_H
@@ -0,0 +1,56 @@
+#ifndef CELLPACKER_H
+#define CELLPACKER_H
+
+#include <mpi.h>
+#include <vector>
+
+#include "board/Board.h"
+
+/**
+ * Packs rectangular areas of a board into MPI messages and back, using CellEncoding.
+ * Every area is preceded by the size of its encoding, so that several areas can follow each other.
+ */
+class CellPacker {
+  public:
+    /**
+     * @brief Gets the maximum amount of bytes a packed area takes.
+     * @param width is the width of the area
+     * @param height is the height of the area
+     * @return the size for MPI_Pack and MPI_Unpack buffers
+     */
+    static int packSize(int width, int height);
+
+    /**
+     * Packs an area of a board, see MPI_Pack.
+     *
+     * @param board is the board to read from
+     * @param start_x, start_y, width, height the area
+     * @param buffer is the buffer the area is packed into, must hold packSize(width, height) more bytes
+     * @param buffer_size is the size of the buffer
+     * @param position is the position in the buffer, moved behind the packed area
+     * @param reference is the board the changes are packed against, see CellEncoding::encode()
+     */
+    void pack(Board *board, int start_x, int start_y, int width, int height, char *buffer, int buffer_size,
+              int &position, Board *reference = nullptr);
+
+    /**
+     * Unpacks an area into a board, see MPI_Unpack.
+     * Throws a std::runtime_error, if the buffer does not hold the area.
+     *
+     * @param board is the board to write to
+     * @param start_x, start_y, width, height the area
+     * @param buffer is the buffer the area is read from
+     * @param buffer_size is the size of the buffer
+     * @param position is the position in the buffer, moved behind the packed area
+     * @param reference is the board changes are applied to, see CellEncoding::decode()
+     */
+    void unpack(Board *board, int start_x, int start_y, int width, int height, char *buffer, int buffer_size,
+                int &position, Board *reference = nullptr);
+
+  private:
+    std::vector<unsigned char> cells; // encoded area, reused so that the cycles do not allocate memory
+
+    unsigned char *getCells(size_t size);
+};
+
+#endif // CELLPACKER_H
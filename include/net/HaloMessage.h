@@ -0,0 +1,80 @@
+#ifndef HALOMESSAGE_H
+#define HALOMESSAGE_H
+
+#include "board/Board.h"
+#include "net/CellEncoding.h"
+#include "net/Message.h"
+
+/**
+ * Carries a part of a row of a client's area directly to the neighbouring client, which needs it
+ * as surrounding row for its next cycle.
+ */
+class HaloMessage : public Message {
+  private:
+    HaloMessage() = delete;
+    HaloMessage(unsigned int sequence_number) : Message(message_type_t::halo, sequence_number) {}
+
+  public:
+    /**
+     * @brief Helper function to create a 'halo' request message carrying a part of a board row.
+     * The part must not hold more than CellEncoding::maxCells(REGION_PAYLOAD_SIZE) cells.
+     * @param buffer memory of at least MAX_MESSAGE_SIZE bytes, the message is constructed in it
+     * @param timestep the cycle the cells were calculated in
+     * @param row, start_x, end_x the part of the row on the whole board
+     * @param upper_border true, if the row is the first row of the area of the sender, else it is the last row
+     * @param board board the cells are read from
+     * @param board_x, board_y position of the part on the given board
+     * @return pointer to the created message, which lives in the buffer.
+     */
+    static HaloMessage *createRequest(void *buffer, unsigned int sequence_number, int timestep, int row,
+                                      bool upper_border, int start_x, int end_x, Board *board, int board_x,
+                                      int board_y) {
+        HaloMessage *message = new (buffer) HaloMessage(sequence_number);
+        message->timestep = timestep;
+        message->row = row;
+        message->upper_border = upper_border;
+        message->start_x = start_x;
+        message->end_x = end_x;
+        if (message->isValidRegion()) {
+            message->payload_size = CellEncoding::encode(board, board_x, board_y, end_x - start_x, 1, message->data);
+        }
+        message->toRequest();
+        return message;
+    };
+
+    /**
+     * @brief Helper function to create a 'halo' reply message.
+     * @param buffer memory of at least MAX_MESSAGE_SIZE bytes, the message is constructed in it
+     * @return pointer to the created message, which lives in the buffer.
+     */
+    static HaloMessage *createReply(void *buffer, unsigned int sequence_number, bool confirmed) {
+        HaloMessage *message = new (buffer) HaloMessage(sequence_number);
+        message->confirmed = confirmed;
+        message->toReply();
+        return message;
+    };
+
+    /**
+     * @brief Checks if the part is not empty and its cells fit into a single message.
+     */
+    bool isValidRegion() {
+        return end_x > start_x && CellEncoding::encodedSize((size_t)(end_x - start_x)) <= REGION_PAYLOAD_SIZE;
+    }
+
+    /**
+     * @brief Gets the amount of bytes which have to be sent, unused payload is left out.
+     */
+    size_t getSize() { return sizeof(HaloMessage) - sizeof(data) + payload_size; }
+
+    int timestep = 0;
+    int row = 0;
+    bool upper_border = false; // the receiver gets it as the row below its area, else as the row above
+    int start_x = 0, end_x = 0;
+    bool confirmed = false;
+    size_t payload_size = 0;
+    unsigned char data[REGION_PAYLOAD_SIZE];
+};
+
+static_assert(sizeof(HaloMessage) <= MAX_MESSAGE_SIZE, "HaloMessage exceeds MAX_MESSAGE_SIZE");
+
+#endif // HALOMESSAGE_H
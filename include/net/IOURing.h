@@ -0,0 +1,110 @@
+#ifndef IOURING_H
+#define IOURING_H
+
+#include <linux/io_uring.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * A thin wrapper around an io_uring instance, which uses the system calls directly.
+ *
+ * Operations are prepared in submission queue entries and passed to the kernel with a single call of submit(),
+ * which can also wait for their completions. A ring is not thread safe, it must be used by one thread at a time.
+ *
+ * Receives can take their memory from a ring of provided buffers, which are registered with the kernel once.
+ * A completion tells which buffer holds the data, the buffer has to be given back after its data was used.
+ */
+class IOURing {
+  public:
+    /**
+     * Sets up the rings, isValid() tells if it worked, e.g. io_uring might be disabled.
+     *
+     * @param entries is the amount of operations, which can be prepared at once
+     */
+    IOURing(unsigned entries);
+
+    ~IOURing();
+
+    bool isValid() { return ring_fd != -1; }
+
+    /**
+     * Gets the next free submission queue entry, it is cleared.
+     *
+     * @return the entry, or nullptr if all entries are prepared but not submitted yet
+     */
+    io_uring_sqe *getSQE();
+
+    /**
+     * Submits the prepared entries and waits for completions.
+     *
+     * @param wait_for is the amount of completions to wait for, 0 does not block
+     * @param timeout is the longest time (in microseconds) to wait, -1 waits until the completions arrived
+     * @return the amount of submitted entries, -1 on error, also if the timeout expired
+     */
+    int submit(unsigned wait_for = 0, int64_t timeout = -1);
+
+    /**
+     * Gets the oldest completion, which was not marked as seen.
+     *
+     * @return the completion, or nullptr if there is none
+     */
+    io_uring_cqe *peekCQE();
+
+    /**
+     * Frees the completion returned by peekCQE().
+     */
+    void seenCQE();
+
+    /**
+     * Registers a ring of buffers, which operations with IOSQE_BUFFER_SELECT can receive into.
+     *
+     * @param group is the id of the buffer group the operations select
+     * @param count is the amount of buffers, a power of two
+     * @param size is the size of every buffer
+     * @return false, if the kernel does not support it
+     */
+    bool provideBuffers(unsigned short group, unsigned count, size_t size);
+
+    /**
+     * @brief Gets the memory of a provided buffer, which a completion refers to.
+     */
+    char *getBuffer(unsigned short id) { return &buffers[id * buffer_size]; }
+
+    /**
+     * Gives a buffer back to the kernel, once its data was used.
+     */
+    void recycleBuffer(unsigned short id);
+
+  private:
+    int ring_fd = -1;
+    unsigned features = 0;
+
+    void *sq_ring = nullptr;
+    void *cq_ring = nullptr;
+    size_t sq_ring_size = 0;
+    size_t cq_ring_size = 0;
+    io_uring_sqe *sqes = nullptr;
+    size_t sqes_size = 0;
+
+    unsigned sq_entries = 0;
+    unsigned *sq_head = nullptr;
+    unsigned *sq_tail = nullptr;
+    unsigned *sq_mask = nullptr;
+    unsigned *sq_array = nullptr;
+    unsigned sqe_tail = 0; // entries before it were handed out, the kernel sees them after submit()
+
+    unsigned *cq_head = nullptr;
+    unsigned *cq_tail = nullptr;
+    unsigned *cq_mask = nullptr;
+    io_uring_cqe *cqes = nullptr;
+
+    io_uring_buf_ring *buffer_ring = nullptr;
+    size_t buffer_ring_size = 0;
+    unsigned buffer_count = 0;
+    unsigned short buffer_tail = 0;
+    size_t buffer_size = 0;
+    std::vector<char> buffers;
+};
+
+#endif // IOURING_H
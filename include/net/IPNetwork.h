@@ -2,6 +2,7 @@
 #define IPNETWORK_H
 
 #include "net/IPAddress.h"
+#include <vector>
 
 class IPNetwork {
   public:
@@ -45,6 +46,158 @@ class IPNetwork {
      * @return the length of the message that was sent
      */
     virtual ssize_t reply(const Client &client, void *res, size_t reslen) = 0;
+
+    /**
+     * Waits for at least one message and receives as many as are available, up to a given count.
+     * Networks which do not support this, receive a single message.
+     *
+     * @param clients is an array of "count" entries for the senders of the messages
+     * @param reqs is an array of "count" buffers, each "reqlen" bytes long
+     * @param reqlen is the length of each buffer
+     * @param lengths is an array of "count" entries for the lengths of the received messages
+     * @param count is the maximum amount of messages to receive
+     * @return the amount of received messages, -1 on error
+     */
+    virtual int receiveBatch(Client *clients, void *reqs, size_t reqlen, ssize_t *lengths, int count) {
+        lengths[0] = receive(clients[0], reqs, reqlen);
+        return lengths[0] < 0 ? -1 : 1;
+    }
+
+    /**
+     * Prepares a reply, which is sent with the next call of flush(). Networks which do not support this,
+     * send the reply right away.
+     *
+     * @param client is the information of the client that has been sent a request
+     * @param res is the buffer that will be send through the network, it may be reused after the call
+     * @param reslen is the length of the buffer
+     * @return the length of the queued message
+     */
+    virtual ssize_t queueReply(const Client &client, void *res, size_t reslen) { return reply(client, res, reslen); }
+
+    /**
+     * Sends all replies prepared with queueReply().
+     */
+    virtual void flush() {}
+
+    /**
+     * Starts a request without waiting for its answer, so several requests can be in flight at once. The answer
+     * is matched to the request by the sequence number of the message. Networks which do not support this,
+     * do the request right away.
+     *
+     * @param server to whom the connection should be done
+     * @param req is the buffer that will be send through the network
+     * @param reqlen is the length of the buffer
+     * @param res is the buffer for the answer of the server, it must stay valid until wait() returns
+     * @param reslen is the length of the buffer "res"
+     * @return handle of the request
+     */
+    virtual int submit(const Server &server, void *req, size_t reqlen, void *res, size_t reslen) {
+        int handle;
+        if (free_handles.empty()) {
+            handle = (int)completed.size();
+            completed.emplace_back();
+        } else {
+            handle = free_handles.back();
+            free_handles.pop_back();
+        }
+        completed[handle].used = true;
+        completed[handle].received_bytes = request(server, req, reqlen, res, reslen);
+        return handle;
+    }
+
+    /**
+     * Checks without blocking, if the answer of a submitted request arrived.
+     *
+     * @param handle of the request
+     * @return true, if the answer arrived
+     */
+    virtual bool poll(int handle) { return true; }
+
+    /**
+     * Waits for the answer of a submitted request, which is written to its "res" buffer.
+     *
+     * @param handle of the request
+     * @param timeout is the time (in seconds) that we wait for an answer before the request is sent again
+     * @return the length of the received message, -1 if the handle is unknown
+     */
+    virtual ssize_t wait(int handle, int timeout = 1) {
+        if (handle < 0 || (size_t)handle >= completed.size() || !completed[handle].used) {
+            return -1;
+        }
+        completed[handle].used = false;
+        free_handles.push_back(handle);
+        return completed[handle].received_bytes;
+    }
+
+    /**
+     * Waits like wait() for the answer of a submitted request, but gives the request up after a time limit.
+     * An answer arriving later is dropped. Networks which do not support this, wait for the answer.
+     *
+     * @param handle of the request
+     * @param limit is the longest time (in milliseconds) that we wait for the answer
+     * @return the length of the received message, -1 if the handle is unknown or the answer did not arrive in time
+     */
+    virtual ssize_t waitFor(int handle, int limit) { return wait(handle); }
+
+    /**
+     * Gets the local port the network is bound to, e.g. after binding to port 0 to let the system choose one.
+     *
+     * @return the port, or 0 if the network is not bound to a port
+     */
+    virtual short getPort() { return 0; }
+
+    /**
+     * Joins a multicast group, whose messages can answer requests started with submitGroup().
+     * Networks which do not support this, stay out of the group.
+     *
+     * @param group is the address and port of the group
+     * @return true, if the group was joined
+     */
+    virtual bool joinGroup(const IPAddress &group) { return false; }
+
+    /**
+     * Starts a request like submit(), whose answer may also be a message sent to the group the network joined.
+     *
+     * @param group_sequence_number is the sequence number of the group message, which answers the request
+     * @return handle of the request
+     */
+    virtual int submitGroup(const Server &server, void *req, size_t reqlen, void *res, size_t reslen,
+                            unsigned int group_sequence_number) {
+        return submit(server, req, reqlen, res, reslen);
+    }
+
+    /**
+     * Prepares a reply, which reaches the client through a message to its group. The reply itself is only
+     * sent, if the client repeats the request. Networks which do not support this, queue the reply.
+     *
+     * @param client is the information of the client that has been sent a request
+     * @param res is the buffer with the reply, it may be reused after the call
+     * @param reslen is the length of the buffer
+     * @return the length of the prepared message
+     */
+    virtual ssize_t queueGroupReply(const Client &client, void *res, size_t reslen) {
+        return queueReply(client, res, reslen);
+    }
+
+    /**
+     * Sends a message to all members of a multicast group.
+     *
+     * @param group is the address and port of the group
+     * @param msg is the buffer that will be send through the network
+     * @param msglen is the length of the buffer
+     * @return the length of the message that was sent, -1 if the network does not support groups
+     */
+    virtual ssize_t sendGroup(const IPAddress &group, void *msg, size_t msglen) { return -1; }
+
+  private:
+    struct Completion {
+        bool used = false; // false, if the entry is free for the next request
+        ssize_t received_bytes = -1;
+    };
+
+    // requests done by submit(), the handle is the index, so only the first requests in flight allocate memory
+    std::vector<Completion> completed;
+    std::vector<int> free_handles; // entries of completed which can be reused
 };
 
 #endif
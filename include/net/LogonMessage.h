@@ -1,6 +1,7 @@
 #ifndef LOGONMESSAGE_H
 #define LOGONMESSAGE_H
 
+#include "net/IPAddress.h"
 #include "net/Message.h"
 
 class LogonMessage : public Message {
@@ -11,34 +12,47 @@ class LogonMessage : public Message {
   public:
     /**
      * @brief Helper function to create a logon request message.
+     * @param buffer memory of at least MAX_MESSAGE_SIZE bytes, the message is constructed in it
      * @param sequence_number sequence number of the message
-     * @return unmanaged pointer to the created message.
+     * @param peer_port port on which the client accepts halo messages from its neighbours, 0 if it does not
+     * @return pointer to the created message, which lives in the buffer.
      */
-    static LogonMessage *createRequest(unsigned int sequence_number) {
-        LogonMessage *msg = new LogonMessage(sequence_number);
+    static LogonMessage *createRequest(void *buffer, unsigned int sequence_number, short peer_port = 0) {
+        LogonMessage *msg = new (buffer) LogonMessage(sequence_number);
+        msg->peer_port = peer_port;
         msg->toRequest();
         return msg;
     };
 
     /**
      * @brief Helper function to create a logon reply message.
+     * @param buffer memory of at least MAX_MESSAGE_SIZE bytes, the message is constructed in it
      * @param sequence_number sequence number, should match a previously received request.
      * @param start_x x position on a board
      * @param start_y y position on a board
      * @param end_x x position on a board
      * @param end_y y position on a board
      * @param timesteps simulation cycles the client has to compute
-     * @return unmanaged pointer to the created message.
+     * @param board_width width of the whole board
+     * @param board_height height of the whole board
+     * @param full_sync true, if the client has to write its whole area to the server every cycle
+     * @param rebalance_interval cycles between changes of the areas, 0 if they never change
+     * @return pointer to the created message, which lives in the buffer.
      */
-    static LogonMessage *createReply(unsigned int sequence_number, int client_id, int start_x, int start_y, int end_x,
-                                     int end_y, int timesteps) {
-        LogonMessage *msg = new LogonMessage(sequence_number);
+    static LogonMessage *createReply(void *buffer, unsigned int sequence_number, int client_id, int start_x,
+                                     int start_y, int end_x, int end_y, int timesteps, int board_width,
+                                     int board_height, bool full_sync, int rebalance_interval) {
+        LogonMessage *msg = new (buffer) LogonMessage(sequence_number);
         msg->client_id = client_id;
         msg->start_x = start_x;
         msg->start_y = start_y;
         msg->end_x = end_x;
         msg->end_y = end_y;
         msg->timesteps = timesteps;
+        msg->board_width = board_width;
+        msg->board_height = board_height;
+        msg->full_sync = full_sync;
+        msg->rebalance_interval = rebalance_interval;
         msg->toReply();
         return msg;
     };
@@ -49,6 +63,20 @@ class LogonMessage : public Message {
     int end_x;
     int end_y;
     int timesteps;
+    int board_width;
+    int board_height;
+    bool full_sync;
+    int rebalance_interval;
+    short peer_port = 0;
+    // all clients exchange the rows around their areas directly, the server decides it for all of them at once
+    bool peer_halos = false;
+    // clients calculating the rows above and below the area, the port is 0 if the neighbour takes no halo messages
+    int upper_peer_id = -1;
+    int lower_peer_id = -1;
+    IPAddress upper_peer = IPAddress((short)0);
+    IPAddress lower_peer = IPAddress((short)0);
+    // multicast group which releases the clients from the barrier, the port is 0 if there is none
+    IPAddress group = IPAddress((short)0);
 };
 
 #endif // LOGONMESSAGE_H
\ No newline at end of file
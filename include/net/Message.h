@@ -1,14 +1,24 @@
 #ifndef MESSAGE_H
 #define MESSAGE_H
 
-enum class message_type_t { invalid, logon, board_set, board_get, barrier };
+#include <new>
+#include <stddef.h>
+
+enum class message_type_t { invalid, logon, board_set, board_get, barrier, region_get, region_set, halo };
 enum class message_mode_t { invalid, request, reply };
 
+// Largest message on the wire, fits into a single ethernet frame as UDP payload. Receive buffers must be this large.
+static const size_t MAX_MESSAGE_SIZE = 1472;
+
+// Bytes of cell data carried by a single region message, larger regions are split into several messages.
+static const size_t REGION_PAYLOAD_SIZE = 1400;
+
 class Message {
   public:
     Message() = delete;
     message_type_t getType() { return type; }
     unsigned int getSequenceNumber() { return sequence_number; }
+    bool isRequest() { return mode == message_mode_t::request; }
     void toRequest() { mode = message_mode_t::request; }
     void toReply() { mode = message_mode_t::reply; }
 
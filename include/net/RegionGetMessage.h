@@ -0,0 +1,73 @@
+#ifndef REGIONGETMESSAGE_H
+#define REGIONGETMESSAGE_H
+
+#include "board/Board.h"
+#include "net/CellEncoding.h"
+#include "net/Message.h"
+
+class RegionGetMessage : public Message {
+  private:
+    RegionGetMessage() = delete;
+    RegionGetMessage(unsigned int sequence_number) : Message(message_type_t::region_get, sequence_number) {}
+
+  public:
+    /**
+     * @brief Helper function to create a 'region get' request message.
+     * The region must not hold more than CellEncoding::maxCells(REGION_PAYLOAD_SIZE) cells.
+     * @param buffer memory of at least MAX_MESSAGE_SIZE bytes, the message is constructed in it
+     * @return pointer to the created message, which lives in the buffer.
+     */
+    static RegionGetMessage *createRequest(void *buffer, unsigned int sequence_number, int start_x, int start_y,
+                                           int end_x, int end_y) {
+        RegionGetMessage *message = new (buffer) RegionGetMessage(sequence_number);
+        message->start_x = start_x;
+        message->start_y = start_y;
+        message->end_x = end_x;
+        message->end_y = end_y;
+        message->toRequest();
+        return message;
+    };
+
+    /**
+     * @brief Helper function to create a 'region get' reply message carrying the requested cells of the board.
+     * Regions that are empty or too large are answered without cells.
+     * @param buffer memory of at least MAX_MESSAGE_SIZE bytes, the message is constructed in it
+     * @return pointer to the created message, which lives in the buffer.
+     */
+    static RegionGetMessage *createReply(void *buffer, unsigned int sequence_number, int start_x, int start_y,
+                                         int end_x, int end_y, Board *board) {
+        RegionGetMessage *message = new (buffer) RegionGetMessage(sequence_number);
+        message->start_x = start_x;
+        message->start_y = start_y;
+        message->end_x = end_x;
+        message->end_y = end_y;
+        if (message->isValidRegion()) {
+            message->payload_size = CellEncoding::encode(board, start_x, start_y, end_x - start_x, end_y - start_y,
+                                                         message->data);
+        }
+        message->toReply();
+        return message;
+    };
+
+    /**
+     * @brief Checks if the region is not empty and its cells fit into a single message.
+     */
+    bool isValidRegion() {
+        return end_x > start_x && end_y > start_y &&
+               CellEncoding::encodedSize((size_t)(end_x - start_x) * (end_y - start_y)) <= REGION_PAYLOAD_SIZE;
+    }
+
+    /**
+     * @brief Gets the amount of bytes which have to be sent, unused payload is left out.
+     */
+    size_t getSize() { return sizeof(RegionGetMessage) - sizeof(data) + payload_size; }
+
+    int start_x = 0, start_y = 0;
+    int end_x = 0, end_y = 0;
+    size_t payload_size = 0;
+    unsigned char data[REGION_PAYLOAD_SIZE];
+};
+
+static_assert(sizeof(RegionGetMessage) <= MAX_MESSAGE_SIZE, "RegionGetMessage exceeds MAX_MESSAGE_SIZE");
+
+#endif // REGIONGETMESSAGE_H
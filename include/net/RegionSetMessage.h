@@ -0,0 +1,75 @@
+#ifndef REGIONSETMESSAGE_H
+#define REGIONSETMESSAGE_H
+
+#include "board/Board.h"
+#include "net/CellEncoding.h"
+#include "net/Message.h"
+
+class RegionSetMessage : public Message {
+  private:
+    RegionSetMessage() = delete;
+    RegionSetMessage(unsigned int sequence_number) : Message(message_type_t::region_set, sequence_number) {}
+
+  public:
+    /**
+     * @brief Helper function to create a 'region set' request message carrying the cells of a board area.
+     * The region must not hold more than CellEncoding::maxCells(REGION_PAYLOAD_SIZE) cells.
+     * @param buffer memory of at least MAX_MESSAGE_SIZE bytes, the message is constructed in it
+     * @param start_x, start_y, end_x, end_y the region on the receiving board
+     * @param board board the cells are read from
+     * @param board_x, board_y position of the region on the given board
+     * @param reference board with the cells the receiver already has at the same positions as on the given board,
+     * only the changes to them are sent. nullptr sends the cells themselves
+     * @return pointer to the created message, which lives in the buffer.
+     */
+    static RegionSetMessage *createRequest(void *buffer, unsigned int sequence_number, int start_x, int start_y,
+                                           int end_x, int end_y, Board *board, int board_x, int board_y,
+                                           Board *reference = nullptr) {
+        RegionSetMessage *message = new (buffer) RegionSetMessage(sequence_number);
+        message->start_x = start_x;
+        message->start_y = start_y;
+        message->end_x = end_x;
+        message->end_y = end_y;
+        if (message->isValidRegion()) {
+            message->payload_size = CellEncoding::encode(board, board_x, board_y, end_x - start_x, end_y - start_y,
+                                                         message->data, reference);
+        }
+        message->toRequest();
+        return message;
+    };
+
+    /**
+     * @brief Helper function to create a 'region set' reply message.
+     * @param buffer memory of at least MAX_MESSAGE_SIZE bytes, the message is constructed in it
+     * @return pointer to the created message, which lives in the buffer.
+     */
+    static RegionSetMessage *createReply(void *buffer, unsigned int sequence_number, bool confirmed) {
+        RegionSetMessage *message = new (buffer) RegionSetMessage(sequence_number);
+        message->confirmed = confirmed;
+        message->toReply();
+        return message;
+    };
+
+    /**
+     * @brief Checks if the region is not empty and its cells fit into a single message.
+     */
+    bool isValidRegion() {
+        return end_x > start_x && end_y > start_y &&
+               CellEncoding::encodedSize((size_t)(end_x - start_x) * (end_y - start_y)) <= REGION_PAYLOAD_SIZE;
+    }
+
+    /**
+     * @brief Gets the amount of bytes which have to be sent, unused payload is left out.
+     */
+    size_t getSize() { return sizeof(RegionSetMessage) - sizeof(data) + payload_size; }
+
+    int start_x = 0, start_y = 0;
+    int end_x = 0, end_y = 0;
+    bool confirmed = false;
+    size_t payload_size = 0;
+    unsigned char data[REGION_PAYLOAD_SIZE];
+};
+
+static_assert(sizeof(RegionSetMessage) <= MAX_MESSAGE_SIZE, "RegionSetMessage exceeds MAX_MESSAGE_SIZE");
+
+#endif // REGIONSETMESSAGE_H
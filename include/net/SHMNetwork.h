@@ -0,0 +1,189 @@
+#ifndef SHMNETWORK_H
+#define SHMNETWORK_H
+
+#include "net/IPNetwork.h"
+#include "net/Message.h"
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+struct MessageRing;
+
+/**
+ * The SHMNetwork Class is used to communicate with servers and clients on the same host without the network stack.
+ *
+ * Every network object owns a ring buffer of messages in POSIX shared memory, which is named after its port.
+ * Sending a message copies it into the ring of the receiver, a waiting receiver is woken up with a futex in the
+ * shared memory. Several networks of a process may share a port, they take the messages from the same ring.
+ *
+ * Addresses are the loopback address with the port of the ring, the host of an address is not used.
+ * Messages are not lost, so requests are only sent again, if the ring of the server did not exist yet or was full.
+ * Replies wait for room in the ring of the client instead, as long as the client is alive. Every ring records the
+ * process which created it, so the ring of a process which crashed does not keep its port in use.
+ */
+class SHMNetwork : IPNetwork {
+  public:
+    /**
+     * Create a network object with a specified port. This is necessary for the server so that it can
+     * offer a service.
+     *
+     * @param port is the port that the server will be bound to, 0 lets the network choose a free one.
+     * The ring of a port is only replaced, if the process which created it is gone.
+     */
+    SHMNetwork(short port);
+
+    /**
+     * Create a network object. A client does not need to specify a port, a free one is chosen for its answers.
+     */
+    SHMNetwork();
+
+    /**
+     * Destructor which detaches the rings, the own one is removed by the last network using it.
+     */
+    ~SHMNetwork();
+
+    /**
+     * Every time a client wants to communicate to the server it has to do a request. It sends its message
+     * with the command that shall be executed and waits for the answer of the server.
+     *
+     * @param server to whom the connection should be done
+     * @param req is the buffer that will be send through the network
+     * @param reqlen is the length of the buffer
+     * @param res is the buffer with the answer of the server
+     * @param reslen is the length of the buffer "res"
+     * @param timeout is the time (in seconds) that we wait before the request is sent again
+     * @return On success, the length of the received message is returned. On error, -1 is returned.
+     */
+    ssize_t request(const Server &server, void *req, size_t reqlen, void *res, size_t reslen, int timeout = 1);
+
+    /**
+     * Wait the whole time for a message that arrives at a specified port.
+     *
+     * @param client is the information of the client that sent a request
+     * @param req is the buffer that will be send through the network
+     * @param reqlen is the length of the buffer
+     * @return On success, the length of the received message is returned. On error, -1 is returned.
+     */
+    ssize_t receive(Client &client, void *req, size_t reqlen);
+
+    /**
+     * Waits for at least one message and takes as many as are in the ring, up to a given count.
+     *
+     * @param clients is an array of "count" entries for the senders of the messages
+     * @param reqs is an array of "count" buffers, each "reqlen" bytes long
+     * @param reqlen is the length of each buffer
+     * @param lengths is an array of "count" entries for the lengths of the received messages
+     * @param count is the maximum amount of messages to receive
+     * @return the amount of received messages, -1 on error
+     */
+    int receiveBatch(Client *clients, void *reqs, size_t reqlen, ssize_t *lengths, int count);
+
+    /**
+     * Send a message to the client from that we received a request.
+     *
+     * @param client is the information of the client that has been sent a request
+     * @param res is the buffer that will be send through the network
+     * @param reslen is the length of the buffer
+     * @return On success, the length of the send message is returned. On error, -1 is returned.
+     */
+    ssize_t reply(const Client &client, void *res, size_t reslen);
+
+    /**
+     * Sends a request without waiting for its answer.
+     *
+     * @param server to whom the connection should be done
+     * @param req is the buffer that will be send through the network
+     * @param reqlen is the length of the buffer
+     * @param res is the buffer for the answer of the server, it must stay valid until wait() returns
+     * @param reslen is the length of the buffer "res"
+     * @return handle of the request
+     */
+    int submit(const Server &server, void *req, size_t reqlen, void *res, size_t reslen);
+
+    /**
+     * Takes all answers which already arrived, without blocking.
+     *
+     * @param handle of the request
+     * @return true, if the answer of the request arrived
+     */
+    bool poll(int handle);
+
+    /**
+     * Takes answers until the one of the given request arrived.
+     *
+     * @param handle of the request
+     * @param timeout is the time (in seconds) between tries to send a request, which could not be sent yet
+     * @return the length of the received message, -1 if the handle is unknown
+     */
+    ssize_t wait(int handle, int timeout = 1);
+
+    /**
+     * Takes answers like wait(), but gives the request up after a time limit.
+     *
+     * @param handle of the request
+     * @param limit is the longest time (in milliseconds) that we wait for the answer
+     * @return the length of the received message, -1 if the answer did not arrive in time
+     */
+    ssize_t waitFor(int handle, int limit);
+
+    /**
+     * Gets the port of the own ring.
+     *
+     * @return the port, or 0 if the ring could not be created
+     */
+    short getPort();
+
+  private:
+    struct PendingRequest {
+        bool used = false; // false, if the entry is free for the next request
+        bool sent = false; // false, as long as the ring of the server did not take the request
+        Server server;
+        char request[MAX_MESSAGE_SIZE];
+        size_t request_length;
+        unsigned int sequence_number;
+        void *res;
+        size_t reslen;
+        ssize_t received_bytes = -1; // -1 until the answer arrived
+    };
+
+    /**
+     * Looks up the ring of a port, it is attached on first use.
+     *
+     * @return the ring, or nullptr if there is no ring for the port (yet)
+     */
+    MessageRing *getRing(unsigned short port);
+
+    /**
+     * Sends all pending requests, which could not be sent so far.
+     */
+    void sendPending();
+
+    /**
+     * Takes answers until the one of the given request arrived, and sends the requests which could not be sent.
+     *
+     * @param deadline is the time the request is given up, if its answer did not arrive until then
+     * @return the length of the received message, -1 if the answer did not arrive in time
+     */
+    ssize_t waitUntil(int handle, int timeout, std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * Takes all answers from the own ring and stores them as answers of the requests with the same sequence
+     * number.
+     *
+     * @param wait_time is the time (in microseconds) to wait for the first answer, 0 to not block
+     */
+    void receiveAnswers(int64_t wait_time);
+
+    static const int64_t SEND_TIMEOUT = 1000000; // microseconds a full ring is waited for, before checking again
+
+    unsigned short port = 0;
+    MessageRing *ring = nullptr;                     // messages sent to this network
+    std::map<unsigned short, MessageRing *> targets; // rings of the servers and clients messages were sent to
+    std::mutex targets_mutex;            // replies may be sent by other threads than the receiving one
+    std::vector<PendingRequest> pending; // submitted requests, the handle is the index
+    std::vector<int> free_handles;       // entries of pending which can be reused
+};
+
+#endif
@@ -3,11 +3,21 @@
 
 #include "net/IPNetwork.h"
 #include <map>
+#include <mutex>
+#include <sys/uio.h>
+#include <vector>
+
+#ifdef USE_IO_URING
+#include "net/IOURing.h"
+#endif
 
 /**
  * The UdpNetwork Class will be used to communicate through the network.
  *
  * every message to a server or to a client shall be send with the help of this class
+ *
+ * Every message on a connection is preceded by its length as 32 bit integer in network byte order,
+ * so several messages can be in flight on a connection and partial reads are put together again.
  */
 class TCPNetwork : IPNetwork {
   public:
@@ -64,9 +74,169 @@ class TCPNetwork : IPNetwork {
      */
     ssize_t reply(const Client &client, void *res, size_t reslen);
 
+    /**
+     * Copies a reply into the send buffer of its connection, which is sent with the next call of flush().
+     *
+     * @param client is the information of the client that has been sent a request
+     * @param res is the buffer that will be send through the network, it may be reused after the call
+     * @param reslen is the length of the buffer
+     * @return the length of the queued message, -1 if the client is not known
+     */
+    ssize_t queueReply(const Client &client, void *res, size_t reslen);
+
+    /**
+     * Sends the queued replies, with a single system call per connection.
+     */
+    void flush();
+
+    /**
+     * Sends a request without waiting for its answer.
+     *
+     * @param server to whom the connection should be done
+     * @param req is the buffer that will be send through the network
+     * @param reqlen is the length of the buffer
+     * @param res is the buffer for the answer of the server, it must stay valid until wait() returns
+     * @param reslen is the length of the buffer "res"
+     * @return handle of the request
+     */
+    int submit(const Server &server, void *req, size_t reqlen, void *res, size_t reslen);
+
+    /**
+     * Receives all answers which already arrived on the connection of the request, without blocking.
+     *
+     * @param handle of the request
+     * @return true, if the answer of the request arrived
+     */
+    bool poll(int handle);
+
+    /**
+     * Receives answers until the one of the given request arrived.
+     *
+     * @param handle of the request
+     * @param timeout is not used, the connection does not lose messages
+     * @return On success, the length of the received message is returned. If the connection was closed, 0 is
+     * returned, -1 if the handle is unknown.
+     */
+    ssize_t wait(int handle, int timeout = 1);
+
+    /**
+     * Receives answers like wait(), but gives the request up after a time limit.
+     *
+     * @param handle of the request
+     * @param limit is the longest time (in milliseconds) that we wait for the answer
+     * @return the length of the received message, 0 if the connection was closed, -1 if the answer did not
+     * arrive in time
+     */
+    ssize_t waitFor(int handle, int limit);
+
+    /**
+     * Gets the local port the network is bound to, e.g. after binding to port 0 to let the system choose one.
+     *
+     * @return the port, or 0 if the network is not bound to a port
+     */
+    short getPort();
+
   private:
+    struct Connection {
+        IPAddress address;
+        std::vector<char> input;  // received bytes, the ones before input_offset were handed out already
+        size_t input_offset = 0;  // messages are taken from here on, the input is compacted when bytes arrive
+        std::vector<char> output; // queued replies
+    };
+
+    struct PendingRequest {
+        bool used = false; // false, if the entry is free for the next request
+        int connection_fd;
+        unsigned int sequence_number;
+        void *res;
+        size_t reslen;
+        ssize_t received_bytes = -1; // -1 until the answer arrived
+    };
+
+    /**
+     * Accepts all pending connections on the listen socket and monitors them.
+     */
+    void acceptConnections();
+
+    /**
+     * Looks up the connection to a server, if there is none yet, it is established.
+     *
+     * @param timeout is the time (in seconds) between tries to connect
+     * @return the socket of the connection
+     */
+    int getConnection(const Server &server, int timeout);
+
+    /**
+     * Stops monitoring a connection and closes it.
+     */
+    void closeConnection(int connection_fd);
+
+    /**
+     * Appends the bytes which arrived at a connection to its input, after dropping the bytes handed out.
+     *
+     * @param block is true, if the call shall wait for bytes to arrive
+     * @return the amount of read bytes, 0 if the connection was closed, -1 if no bytes were available
+     */
+    ssize_t readInput(int connection_fd, Connection &connection, bool block);
+
+    /**
+     * Checks if the input of a connection holds a complete message.
+     */
+    bool hasMessage(Connection &connection);
+
+    /**
+     * Removes the first complete message from the input of a connection and copies it into a buffer.
+     * Messages longer than the buffer are cut off.
+     *
+     * @return false, if there is no complete message
+     */
+    bool takeMessage(Connection &connection, void *buffer, size_t length, ssize_t &message_length);
+
+    /**
+     * Receives a single answer on a connection and stores it as answer of the request with the same sequence
+     * number.
+     *
+     * @param block is true, if the call shall wait for the answer to arrive, also across interrupting signals
+     * @return false, if there was no answer without blocking or the connection was closed
+     */
+    bool receiveAnswer(int connection_fd, bool block);
+
+    /**
+     * Sends a message with its length in front, without copying it.
+     */
+    ssize_t sendMessage(int connection_fd, void *data, size_t length);
+
+    /**
+     * Writes buffers completely, even if the system takes only a part of them at once.
+     *
+     * @return false, if the buffers could not be written
+     */
+    bool writeAll(int connection_fd, iovec *buffers, int count);
+
+#ifdef USE_IO_URING
+    /**
+     * Sends the queued replies of all connections with as few submissions as possible and waits until they were
+     * sent. Replies which were only sent in part are completed with writeAll().
+     */
+    void flushURing();
+
+    static const unsigned URING_ENTRIES = 256; // connections whose replies are submitted at once
+
+    IOURing *send_ring = nullptr;
+#endif
+
+    static const int EPOLL_MAX_EVENTS = 64; // events fetched by a single wait
+
     int socket_fd = -1;
-    std::map<IPAddress, int, IPAddressComparer> connections;
+    int epoll_fd = -1;                                       // monitors the listen socket and all connections
+    std::vector<int> ready;                                  // sockets which may have requests to receive
+    size_t ready_head = 0;                                   // sockets before it in ready were handled
+    std::map<IPAddress, int, IPAddressComparer> connections; // socket of every connection
+    std::map<int, Connection> sockets;                       // state of every connection by socket
+    std::vector<int> queued;                                 // sockets with queued replies
+    std::mutex connections_mutex; // replies may be sent by other threads than the receiving one
+    std::vector<PendingRequest> pending; // submitted requests, the handle is the index
+    std::vector<int> free_handles;       // entries of pending which can be reused
 };
 
 #endif
@@ -2,11 +2,31 @@
 #define UDPNETWORK_H
 
 #include "net/IPNetwork.h"
+#include "net/Message.h"
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <vector>
+
+#ifdef USE_IO_URING
+#include "net/IOURing.h"
+#endif
 
 /**
  * The UdpNetwork Class will be used to communicate through the network.
  *
  * every message to a server or to a client shall be send with the help of this class
+ *
+ * Lost datagrams are handled by sending requests again. The time to wait for an answer is derived from the
+ * measured round trip times, logons, barriers and group requests are not measured, since their answers also wait
+ * for the other clients. The receiving side recognizes repeated requests by their sequence number, and
+ * answers them from a window of recent replies instead of passing them on again.
+ *
+ * Clients may join a multicast group, so a server can answer the requests of many clients with a single
+ * datagram. Their replies are kept in the window, a client which lost the group message gets it by sending
+ * its request again.
  */
 class UDPNetwork : IPNetwork {
   public:
@@ -62,8 +82,250 @@ class UDPNetwork : IPNetwork {
      */
     ssize_t reply(const Client &client, void *res, size_t reslen);
 
+    /**
+     * Waits for at least one message and receives as many as are available with a single system call.
+     * Repeated requests are answered or dropped, as with receive().
+     *
+     * @param clients is an array of "count" entries for the senders of the messages
+     * @param reqs is an array of "count" buffers, each "reqlen" bytes long
+     * @param reqlen is the length of each buffer
+     * @param lengths is an array of "count" entries for the lengths of the received messages
+     * @param count is the maximum amount of messages to receive
+     * @return the amount of received messages, -1 on error
+     */
+    int receiveBatch(Client *clients, void *reqs, size_t reqlen, ssize_t *lengths, int count);
+
+    /**
+     * Copies a reply into the send queue, which is sent with the next call of flush().
+     *
+     * @param client is the information of the client that has been sent a request
+     * @param res is the buffer that will be send through the network, it may be reused after the call
+     * @param reslen is the length of the buffer
+     * @return the length of the queued message
+     */
+    ssize_t queueReply(const Client &client, void *res, size_t reslen);
+
+    /**
+     * Sends all queued replies with as few system calls as possible.
+     */
+    void flush();
+
+    /**
+     * Sends a request without waiting for its answer.
+     *
+     * @param server to whom the connection should be done
+     * @param req is the buffer that will be send through the network
+     * @param reqlen is the length of the buffer
+     * @param res is the buffer for the answer of the server, it must stay valid until wait() returns
+     * @param reslen is the length of the buffer "res"
+     * @return handle of the request, -1 if there is no socket
+     */
+    int submit(const Server &server, void *req, size_t reqlen, void *res, size_t reslen);
+
+    /**
+     * Receives all answers which already arrived, without blocking.
+     *
+     * @param handle of the request
+     * @return true, if the answer of the request arrived
+     */
+    bool poll(int handle);
+
+    /**
+     * Receives answers until the one of the given request arrived. Requests, whose answer does not arrive
+     * within the retransmission timeout, are sent again with a doubled timeout.
+     *
+     * @param handle of the request
+     * @param timeout is the longest time (in seconds) that we wait for an answer before sending again
+     * @return On success, the length of the received message is returned. On error, -1 is returned.
+     */
+    ssize_t wait(int handle, int timeout = 1);
+
+    /**
+     * Receives answers like wait(), but gives the request up after a time limit.
+     *
+     * @param handle of the request
+     * @param limit is the longest time (in milliseconds) that we wait for the answer
+     * @return the length of the received message, -1 if the answer did not arrive in time
+     */
+    ssize_t waitFor(int handle, int limit);
+
+    /**
+     * Gets the local port the network is bound to, e.g. after binding to port 0 to let the system choose one.
+     *
+     * @return the port, or 0 if the network is not bound to a port
+     */
+    short getPort();
+
+    /**
+     * Joins a multicast group with a second socket bound to the port of the group.
+     *
+     * @param group is the address and port of the group
+     * @return true, if the group was joined
+     */
+    bool joinGroup(const IPAddress &group);
+
+    /**
+     * Sends a request without waiting for its answer, which is either the reply of the server or the message
+     * sent to the group with the given sequence number.
+     *
+     * @param server to whom the connection should be done
+     * @param req is the buffer that will be send through the network
+     * @param reqlen is the length of the buffer
+     * @param res is the buffer for the answer, it must stay valid until wait() returns
+     * @param reslen is the length of the buffer "res"
+     * @param group_sequence_number is the sequence number of the group message, which answers the request
+     * @return handle of the request, -1 if there is no socket
+     */
+    int submitGroup(const Server &server, void *req, size_t reqlen, void *res, size_t reslen,
+                    unsigned int group_sequence_number);
+
+    /**
+     * Keeps a reply in the window of the client without sending it, the client gets a group message instead.
+     *
+     * @param client is the information of the client that has been sent a request
+     * @param res is the buffer with the reply, it may be reused after the call
+     * @param reslen is the length of the buffer
+     * @return the length of the kept message
+     */
+    ssize_t queueGroupReply(const Client &client, void *res, size_t reslen);
+
+    /**
+     * Sends a message to all members of a multicast group right away.
+     *
+     * @param group is the address and port of the group
+     * @param msg is the buffer that will be send through the network
+     * @param msglen is the length of the buffer
+     * @return On success, the length of the send message is returned. On error, -1 is returned.
+     */
+    ssize_t sendGroup(const IPAddress &group, void *msg, size_t msglen);
+
   private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct PendingRequest {
+        bool used = false; // false, if the entry is free for the next request
+        IPAddress server;
+        char request[MAX_MESSAGE_SIZE]; // kept to send it again
+        size_t request_length;
+        unsigned int sequence_number;
+        void *res;
+        size_t reslen;
+        ssize_t received_bytes = -1; // -1 until the answer arrived
+        Clock::time_point sent_at;
+        int64_t timeout = 0;           // microseconds until the request is sent again
+        bool sent_again = false;       // round trip times of requests sent more than once are ambiguous
+        bool waits_for_others = false; // the answer also waits for other clients, e.g. at a barrier
+        bool group_answer = false;     // true, if a group message may answer the request
+        unsigned int group_sequence_number = 0;
+    };
+
+    enum class request_state_t { empty, in_progress, answered };
+
+    // a request of a client which is being handled or was answered recently
+    struct WindowEntry {
+        request_state_t state = request_state_t::empty;
+        unsigned int sequence_number = 0;
+        size_t reply_length = 0;
+        char reply[MAX_MESSAGE_SIZE];
+    };
+
+    // recent requests of a client, a request is stored at its sequence number modulo REPLY_WINDOW
+    struct ClientWindow {
+        std::vector<WindowEntry> entries;
+        ClientWindow() : entries(REPLY_WINDOW) {}
+    };
+
+    static const int64_t INITIAL_RTO = 200000; // microseconds, until the first round trip time was measured
+    static const int64_t MIN_RTO = 1000;
+    static const int64_t MAX_RTO = 1000000;
+    static const size_t REPLY_WINDOW = 64; // replies kept per client to answer repeated requests
+
+    /**
+     * Updates the retransmission timeout with a measured round trip time, as described in RFC 6298.
+     *
+     * @param rtt is the round trip time in microseconds
+     */
+    void updateRTO(int64_t rtt);
+
+    /**
+     * Receives answers until the one of the given request arrived, and sends overdue requests again.
+     *
+     * @param deadline is the time the request is given up, if its answer did not arrive until then
+     * @return the length of the received message, -1 if the answer did not arrive in time
+     */
+    ssize_t waitUntil(int handle, int timeout, Clock::time_point deadline);
+
+    /**
+     * Checks if a received message is a request which was received before. Such a request is answered
+     * from the window of recent replies, if its reply was already sent.
+     *
+     * @return true, if the message must not be passed on
+     */
+    bool isRepeatedRequest(const Client &client, void *req, ssize_t reqlen);
+
+    /**
+     * Keeps a reply in the window of its client, in case the request is sent again.
+     */
+    void rememberReply(const Client &client, void *res, size_t reslen);
+
+    /**
+     * Receives a single message and stores it as answer of the request with the same sequence number.
+     * Messages without such a request, e.g. answers of requests which were sent twice, are dropped.
+     *
+     * @param fd is the socket of the network or the one of the group
+     * @param flags are passed to recvfrom, e.g. MSG_DONTWAIT
+     * @return false, if no message could be received
+     */
+    bool receiveAnswer(int fd, int flags);
+
+#ifdef USE_IO_URING
+    /**
+     * Sets up the io_uring of a server, receives are then kept in flight by a multishot receive into provided
+     * buffers and the replies of a flush are submitted at once. Without io_uring support the system calls are used.
+     */
+    void setupURing();
+
+    /**
+     * Receives like receiveBatch(), but takes the messages from the completions of the multishot receive.
+     */
+    int receiveBatchURing(Client *clients, void *reqs, size_t reqlen, ssize_t *lengths, int count);
+
+    /**
+     * Sends the queued replies with as few submissions as possible and waits until they were sent.
+     *
+     * @return the amount of replies handed to the kernel, the others are left to sendmmsg
+     */
+    size_t flushURing(size_t count);
+
+    static const unsigned URING_ENTRIES = 256;         // operations in flight, also the amount of receive buffers
+    static const unsigned short RECEIVE_BUFFER_GROUP = 0;
+    static const int64_t RECEIVE_WAIT = 100000; // microseconds between checks, if the receiving thread was cancelled
+
+    IOURing *receive_ring = nullptr;
+    IOURing *send_ring = nullptr;
+    msghdr receive_template; // tells the multishot receive how much room the sender address needs
+    bool receive_armed = false;
+#endif
+
     int socket_fd = -1;
+    int group_fd = -1; // receives the messages of the joined group
+    std::vector<PendingRequest> pending; // submitted requests, the handle is the index
+    std::vector<int> free_handles;       // entries of pending which can be reused
+    int64_t srtt = 0;                      // smoothed round trip time in microseconds
+    int64_t rttvar = 0;                    // round trip time variation in microseconds
+    int64_t rto = INITIAL_RTO;             // retransmission timeout in microseconds
+    bool rtt_measured = false;
+    std::map<IPAddress, ClientWindow, IPAddressComparer> windows;
+    std::mutex windows_mutex; // replies may be sent by other threads than the receiving one
+    std::vector<mmsghdr> receive_headers;
+    std::vector<iovec> receive_iovecs;
+    std::vector<IPAddress> queued_clients; // replies waiting for flush()
+    std::vector<size_t> queued_offsets;
+    std::vector<size_t> queued_lengths;
+    std::vector<char> queued_data;
+    std::vector<mmsghdr> send_headers;
+    std::vector<iovec> send_iovecs;
+    std::mutex queue_mutex;
 };
 
 #endif
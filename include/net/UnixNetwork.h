@@ -0,0 +1,251 @@
+#ifndef UNIXNETWORK_H
+#define UNIXNETWORK_H
+
+#include "net/IPNetwork.h"
+#include "net/Message.h"
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <vector>
+
+/**
+ * The UnixNetwork Class is used to communicate with servers and clients on the same host through unix domain
+ * sockets, which spare the checksums and routing of the IP loopback.
+ *
+ * Sockets are bound to abstract names made of their port, so addresses are the loopback address with a port like
+ * for the other networks, the host of an address is not used. Several networks of a process may share a port,
+ * like sockets sharing a port with SO_REUSEPORT.
+ *
+ * Datagram sockets are used by default, they neither lose nor reorder messages on the same host. Stream networks
+ * use sequenced packet sockets, which keep the boundaries of the messages on their connections.
+ * Requests are only sent again, if the server did not exist yet.
+ */
+class UnixNetwork : IPNetwork {
+  public:
+    /**
+     * Create a network object with a specified port. This is necessary for the server so that it can
+     * offer a service.
+     *
+     * @param port is the port that the server will be bound to, 0 lets the network choose a free one
+     * @param stream is true, if connections are used instead of datagrams
+     */
+    UnixNetwork(short port, bool stream);
+
+    /**
+     * Create a network object. A client does not need to specify a port, a free one is chosen for its answers.
+     *
+     * @param stream is true, if connections are used instead of datagrams
+     */
+    UnixNetwork(bool stream);
+
+    /**
+     * Destructor which closes the sockets, the one of the port is closed by the last network using it.
+     */
+    ~UnixNetwork();
+
+    /**
+     * Every time a client wants to communicate to the server it has to do a request. It sends its message
+     * with the command that shall be executed and waits for the answer of the server.
+     *
+     * @param server to whom the connection should be done
+     * @param req is the buffer that will be send through the network
+     * @param reqlen is the length of the buffer
+     * @param res is the buffer with the answer of the server
+     * @param reslen is the length of the buffer "res"
+     * @param timeout is the time (in seconds) that we wait before the request is sent again
+     * @return On success, the length of the received message is returned. On error, -1 is returned.
+     */
+    ssize_t request(const Server &server, void *req, size_t reqlen, void *res, size_t reslen, int timeout = 1);
+
+    /**
+     * Wait the whole time for a message that arrives at a specified port.
+     *
+     * @param client is the information of the client that sent a request
+     * @param req is the buffer that will be send through the network
+     * @param reqlen is the length of the buffer
+     * @return On success, the length of the received message is returned. On error, -1 is returned.
+     */
+    ssize_t receive(Client &client, void *req, size_t reqlen);
+
+    /**
+     * Waits for at least one message and receives as many as are available, up to a given count.
+     * Stream networks receive a single message.
+     *
+     * @param clients is an array of "count" entries for the senders of the messages
+     * @param reqs is an array of "count" buffers, each "reqlen" bytes long
+     * @param reqlen is the length of each buffer
+     * @param lengths is an array of "count" entries for the lengths of the received messages
+     * @param count is the maximum amount of messages to receive
+     * @return the amount of received messages, -1 on error
+     */
+    int receiveBatch(Client *clients, void *reqs, size_t reqlen, ssize_t *lengths, int count);
+
+    /**
+     * Send a message to the client from that we received a request.
+     *
+     * @param client is the information of the client that has been sent a request
+     * @param res is the buffer that will be send through the network
+     * @param reslen is the length of the buffer
+     * @return On success, the length of the send message is returned. On error, -1 is returned.
+     */
+    ssize_t reply(const Client &client, void *res, size_t reslen);
+
+    /**
+     * Copies a reply into a queue, which is sent with the next call of flush(). Stream networks send the reply
+     * right away.
+     *
+     * @param client is the information of the client that has been sent a request
+     * @param res is the buffer that will be send through the network, it may be reused after the call
+     * @param reslen is the length of the buffer
+     * @return the length of the queued message
+     */
+    ssize_t queueReply(const Client &client, void *res, size_t reslen);
+
+    /**
+     * Sends all queued replies with as few system calls as possible.
+     */
+    void flush();
+
+    /**
+     * Sends a request without waiting for its answer.
+     *
+     * @param server to whom the connection should be done
+     * @param req is the buffer that will be send through the network
+     * @param reqlen is the length of the buffer
+     * @param res is the buffer for the answer of the server, it must stay valid until wait() returns
+     * @param reslen is the length of the buffer "res"
+     * @return handle of the request, -1 if there is no socket
+     */
+    int submit(const Server &server, void *req, size_t reqlen, void *res, size_t reslen);
+
+    /**
+     * Receives all answers which already arrived, without blocking.
+     *
+     * @param handle of the request
+     * @return true, if the answer of the request arrived
+     */
+    bool poll(int handle);
+
+    /**
+     * Receives answers until the one of the given request arrived.
+     *
+     * @param handle of the request
+     * @param timeout is the time (in seconds) between tries to send a request, whose server did not exist yet
+     * @return the length of the received message, 0 if the connection was closed, -1 if the handle is unknown
+     */
+    ssize_t wait(int handle, int timeout = 1);
+
+    /**
+     * Receives answers like wait(), but gives the request up after a time limit.
+     *
+     * @param handle of the request
+     * @param limit is the longest time (in milliseconds) that we wait for the answer
+     * @return the length of the received message, -1 if the answer did not arrive in time
+     */
+    ssize_t waitFor(int handle, int limit);
+
+    /**
+     * Gets the port the network is bound to.
+     *
+     * @return the port, or 0 if the network is not bound to a port
+     */
+    short getPort();
+
+  private:
+    struct PendingRequest {
+        bool used = false; // false, if the entry is free for the next request
+        bool sent = false; // false, as long as the server did not exist
+        Server server;
+        char request[MAX_MESSAGE_SIZE]; // kept to send it again
+        size_t request_length;
+        unsigned int sequence_number;
+        void *res;
+        size_t reslen;
+        ssize_t received_bytes = -1; // -1 until the answer arrived
+    };
+
+    /**
+     * Tries to send a request, if the socket of the server is full, arriving answers are received meanwhile.
+     *
+     * @return false, if the server does not exist
+     */
+    bool sendRequest(PendingRequest &request);
+
+    /**
+     * Sends all pending requests, which could not be sent so far.
+     *
+     * @return true, if all requests were sent
+     */
+    bool sendPending();
+
+    /**
+     * Receives answers until the one of the given request arrived, and sends the requests which could not be sent.
+     *
+     * @param deadline is the time the request is given up, if its answer did not arrive until then
+     * @return the length of the received message, -1 if the answer did not arrive in time
+     */
+    ssize_t waitUntil(int handle, int timeout, std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * Receives all answers which arrived and stores them as answers of the requests with the same sequence number.
+     *
+     * @param wait_time is the time (in milliseconds) to wait for the first answer, 0 to not block, -1 to wait
+     * until it arrives
+     */
+    void receiveAnswers(int wait_time);
+
+    /**
+     * Stores a received message as answer of the request with the same sequence number.
+     */
+    void storeAnswer(char *buffer, ssize_t received_bytes);
+
+    /**
+     * Accepts all pending connections on the listen socket and monitors them.
+     */
+    void acceptConnections();
+
+    /**
+     * Looks up the connection to a server, if there is none yet, it is established.
+     *
+     * @return the socket of the connection, -1 if the server does not exist
+     */
+    int getConnection(const Server &server);
+
+    /**
+     * Stops monitoring a connection and closes it, requests waiting for an answer on it get an empty one.
+     */
+    void closeConnection(int connection_fd);
+
+    static const int EPOLL_MAX_EVENTS = 64; // events fetched by a single wait
+
+    int type;
+    unsigned short port = 0;
+    int socket_fd = -1; // datagram socket or listen socket of the port
+    int epoll_fd = -1;  // monitors the listen socket and all accepted connections
+    std::vector<int> ready;                                  // connections which may have requests to receive
+    size_t ready_head = 0;                                   // connections before it in ready were handled
+    std::map<IPAddress, int, IPAddressComparer> connections; // socket of every connection
+    std::map<int, IPAddress> sockets;                        // address of every connection by socket
+    std::mutex connections_mutex; // replies may be sent by other threads than the receiving one
+    std::vector<PendingRequest> pending; // submitted requests, the handle is the index
+    std::vector<int> free_handles;       // entries of pending which can be reused
+    std::vector<pollfd> poll_fds;        // sockets monitored for answers, reused by every call
+
+    // replies waiting for flush()
+    std::mutex queue_mutex;
+    std::vector<sockaddr_un> queued_addresses;
+    std::vector<socklen_t> queued_address_lengths;
+    std::vector<size_t> queued_offsets;
+    std::vector<size_t> queued_lengths;
+    std::vector<char> queued_data;
+    std::vector<mmsghdr> send_headers;
+    std::vector<iovec> send_iovecs;
+    std::vector<mmsghdr> receive_headers;
+    std::vector<iovec> receive_iovecs;
+    std::vector<sockaddr_un> receive_addresses;
+};
+
+#endif
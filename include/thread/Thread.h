@@ -66,7 +66,7 @@ protected:
 
 private:
 	pthread_t thread;
-	bool running;
+	bool running = false;
 
 	static void* helper(void* args)
 	{
@@ -1,18 +1,32 @@
 #include "board/BoardServer.h"
 
+void BoardServerWorker::run() { server->serve(net); };
+
 BoardServer::BoardServer(IPNetwork *net, size_t client_count, Board *board_read, Board *board_write, int timesteps)
-    : net(net), client_count(client_count), board_read(board_read), board_write(board_write), timesteps(timesteps) {
-    if (client_count > (size_t)board_read->getHeight()) {
-        LOG(WARN) << "Too many clients specified, maximum amount for given board is " << board_read->getHeight();
-        LOG(WARN) << "Reducing required clients to maximum amount";
-        this->client_count = (size_t)board_read->getHeight();
-    }
+    : BoardServer(std::vector<IPNetwork *>{net}, client_count, board_read, board_write, timesteps){};
 
+BoardServer::BoardServer(std::vector<IPNetwork *> nets, size_t client_count, Board *board_read, Board *board_write,
+                         int timesteps)
+    : nets(nets), client_count(client_count), board_read(board_read), board_write(board_write),
+      timesteps(timesteps) {
     if (client_count > (size_t)INT_MAX) {
         throw std::invalid_argument("'client_count' was too high, maxmimum is " + std::to_string(INT_MAX));
     }
 
+    // every client needs at least a cell, rows always work
+    int grid_rows, grid_columns;
+    if (!LoadBalancer::chooseGrid(board_read->getWidth(), board_read->getHeight(), (int)client_count, grid_rows,
+                                  grid_columns) &&
+        client_count > (size_t)board_read->getHeight()) {
+        LOG(WARN) << "Too many clients specified, the blocks of the clients do not fit into the board";
+        LOG(WARN) << "Reducing required clients to " << board_read->getHeight();
+        this->client_count = (size_t)board_read->getHeight();
+    }
+
     board_write->clear();
+    balancer = LoadBalancer(board_read->getWidth(), board_read->getHeight(), (int)this->client_count);
+    LOG(INFO) << "Splitting the board into " << balancer.getGridRows() << " x " << balancer.getGridColumns()
+              << " blocks";
 };
 
 BoardServer::~BoardServer() {
@@ -27,132 +41,283 @@ void BoardServer::start() {
     LOG(INFO) << "Server started, using exactly " << client_count << " client(s) to calculate " << timesteps
               << " cycle(s)";
 
-    IPAddress client_address = IPAddress();
+    if (nets.size() == 1) {
+        serve(nets[0]);
+        return;
+    }
+
+    // every network is served by a thread of its own
+    std::vector<BoardServerWorker *> workers;
+    for (IPNetwork *net : nets) {
+        BoardServerWorker *worker = new BoardServerWorker(this, net);
+        worker->create();
+        workers.push_back(worker);
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(barrier_mutex);
+        finished.wait(lock, [this] { return timestep >= timesteps; });
+    }
+
+    // the other workers still wait for requests, which will not come anymore
+    for (BoardServerWorker *worker : workers) {
+        delete worker;
+    }
+};
+
+void BoardServer::serve(IPNetwork *net) {
+    std::vector<IPAddress> client_addresses(RECEIVE_BATCH);
+    std::vector<char> buffers(RECEIVE_BATCH * MAX_MESSAGE_SIZE);
+    std::vector<ssize_t> lengths(RECEIVE_BATCH);
+    std::vector<char> reply_buffer(MAX_MESSAGE_SIZE);
     while (timestep < timesteps) {
+        // receive as many messages as there are, but at least one
+        int count = net->receiveBatch(client_addresses.data(), buffers.data(), MAX_MESSAGE_SIZE, lengths.data(),
+                                      RECEIVE_BATCH);
+        for (int i = 0; i < count; i++) {
+            char *buffer = &buffers[i * MAX_MESSAGE_SIZE];
+            size_t length = std::max(lengths[i], (ssize_t)0);
+            bzero(buffer + length, MAX_MESSAGE_SIZE - length);
+            handle(net, client_addresses[i], buffer, reply_buffer.data());
+        }
 
-        client_address.setAddr(0);
-        client_address.setPort(0);
+        // answer the whole batch at once
+        net->flush();
+    }
+};
 
-        // receive bytes from a client
-        char buffer[100];
-        bzero(buffer, sizeof(buffer));
-        net->receive(client_address, buffer, sizeof(buffer));
+void BoardServer::handle(IPNetwork *net, IPAddress &client_address, char *buffer, char *reply_buffer) {
+    // convert bytes to a message
+    Message *message = (Message *)buffer;
+    unsigned int sequence_number = message->getSequenceNumber();
 
-        // convert bytes to a message
-        Message *message = (Message *)buffer;
-        unsigned int sequence_number = message->getSequenceNumber();
+    // parse message
+    message_type_t message_type = message->getType();
 
-        // parse message
-        message_type_t message_type = message->getType();
+    switch (message_type) {
+    case message_type_t::logon: {
+        LogonMessage *req = (LogonMessage *)buffer;
+        logon(net, new IPAddress(client_address), sequence_number, req->peer_port);
+        break;
+    }
+    case message_type_t::board_get: {
+        BoardGetMessage *req = (BoardGetMessage *)buffer;
+        BoardGetMessage *rep =
+            BoardGetMessage::createReply(reply_buffer, sequence_number, req->pos_x, req->pos_y, board_read);
+        net->queueReply(client_address, rep, sizeof(BoardGetMessage));
+        break;
+    }
+    case message_type_t::board_set: {
+        BoardSetMessage *req = (BoardSetMessage *)buffer;
+        board_write->setPos(req->pos_x, req->pos_y, req->state);
+        BoardSetMessage *rep = BoardSetMessage::createReply(reply_buffer, sequence_number);
+        net->queueReply(client_address, rep, sizeof(BoardSetMessage));
+        break;
+    }
+    case message_type_t::region_get: {
+        RegionGetMessage *req = (RegionGetMessage *)buffer;
+        RegionGetMessage *rep = RegionGetMessage::createReply(reply_buffer, sequence_number, req->start_x,
+                                                              req->start_y, req->end_x, req->end_y, board_read);
+        net->queueReply(client_address, rep, rep->getSize());
+        break;
+    }
+    case message_type_t::region_set: {
+        // changes are sent relative to the cells of the last cycle, which are still on the read board
+        RegionSetMessage *req = (RegionSetMessage *)buffer;
+        bool confirmed = req->isValidRegion() &&
+                         CellEncoding::decode(board_write, req->start_x, req->start_y, req->end_x - req->start_x,
+                                              req->end_y - req->start_y, req->data, req->payload_size, board_read);
+        RegionSetMessage *rep = RegionSetMessage::createReply(reply_buffer, sequence_number, confirmed);
+        net->queueReply(client_address, rep, rep->getSize());
+        break;
+    }
+    case message_type_t::barrier: {
+        BarrierMessage *req = (BarrierMessage *)buffer;
+        barrier(req->client_id, sequence_number, req->finished_timestep, req->step_time, req->group_member);
+        break;
+    }
+    default: {
+        LOG(DEBUG) << (ssize_t)message->getType() << " is not a handled message type";
+        break;
+    }
+    }
+};
 
-        switch (message_type) {
-        case message_type_t::logon: {
-            logon(new IPAddress(client_address), sequence_number);
-            break;
-        }
-        case message_type_t::board_get: {
-            BoardGetMessage *req = (BoardGetMessage *)buffer;
-            BoardGetMessage *rep = BoardGetMessage::createReply(sequence_number, req->pos_x, req->pos_y, board_read);
-            net->reply(client_address, rep, sizeof(BoardGetMessage));
-            delete rep;
-            break;
-        }
-        case message_type_t::board_set: {
-            BoardSetMessage *req = (BoardSetMessage *)buffer;
-            board_write->setPos(req->pos_x, req->pos_y, req->state);
-            BoardSetMessage *rep = BoardSetMessage::createReply(sequence_number);
-            net->reply(client_address, rep, sizeof(BoardSetMessage));
-            delete rep;
-            break;
-        }
-        case message_type_t::barrier: {
-            BarrierMessage *req = (BarrierMessage *)buffer;
-            barrier(req->client_id, sequence_number, req->finished_timestep);
-            break;
-        }
-        default: {
-            LOG(DEBUG) << (ssize_t)message->getType() << " is not a handled message type";
-            break;
-        }
+void BoardServer::logon(IPNetwork *net, IPAddress *client_address, unsigned int login_sequence_number,
+                        short peer_port) {
+    std::lock_guard<std::mutex> lock(barrier_mutex);
+
+    // a repeated request, the client did not get the reply yet
+    for (ClientInfo *client : clients) {
+        if (*client->address == *client_address) {
+            delete client_address;
+            if (clients.size() == client_count) {
+                notifyLogon(client->client_id);
+                client->net->flush();
+            }
+            return;
         }
     }
-};
 
-void BoardServer::logon(IPAddress *client_address, unsigned int login_sequence_number) {
+    if (clients.size() >= client_count) {
+        LOG(WARN) << "Ignoring logon from " << client_address->getAddr() << ":" << client_address->getPort()
+                  << ", all clients are already registered";
+        delete client_address;
+        return;
+    }
+
     // register new client
     int client_id = (int)clients.size();
     ClientInfo *client_info = new ClientInfo();
     client_info->client_id = client_id;
     client_info->address = client_address;
+    client_info->net = net;
     client_info->last_sequence_number = login_sequence_number;
+    client_info->logon_sequence_number = login_sequence_number;
+    client_info->peer_port = peer_port;
     clients.push_back(client_info);
 
-    // calculate managed area for client
-    int start_x, start_y, end_x, end_y;
-    size_t rows_per_client = (size_t)board_read->getHeight() / client_count;
-    size_t remaining_rows = (size_t)board_read->getHeight() - (rows_per_client * client_count);
-    bool is_last_client = (size_t)client_id >= client_count - 1;
-    size_t rows_for_this_client = is_last_client ? rows_per_client + remaining_rows : rows_per_client;
-    start_x = 0;
-    start_y = rows_per_client * client_id;
-    end_x = board_read->getWidth();
-    end_y = start_y + rows_for_this_client;
-
-    // send client confirmation
-    LogonMessage *rep =
-        LogonMessage::createReply(login_sequence_number, client_id, start_x, start_y, end_x, end_y, this->timesteps);
-    net->reply(*client_address, rep, sizeof(LogonMessage));
-    delete rep;
-
     LOG(INFO) << "New client with id " << client_id << " and address " << client_address->getAddr() << ":"
               << client_address->getPort() << " registered";
+
+    // neighbours are only known, once all clients are there
+    if (clients.size() == client_count) {
+        // a client waits for the answers to its halo messages, so all of them switch to halos or none,
+        // and only if the areas span whole rows
+        peer_halos = balancer.getGridColumns() == 1;
+        for (ClientInfo *client : clients) {
+            peer_halos = peer_halos && client->peer_port != 0;
+        }
+        registered = true;
+        for (ClientInfo *client : clients) {
+            notifyLogon(client->client_id);
+        }
+        for (IPNetwork *net : nets) {
+            net->flush();
+        }
+    }
+};
+
+void BoardServer::calculateArea(int client_id, int &start_x, int &start_y, int &end_x, int &end_y) {
+    balancer.getArea(client_id, start_x, start_y, end_x, end_y);
 };
 
-void BoardServer::barrier(int client_id, unsigned int barrier_sequence_number, int completed_timestep) {
-    // validate client id
-    if (client_id < 0 || (size_t)client_id >= clients.size()) {
+bool BoardServer::isWholeAreaWritten(int cycle) {
+    // the areas may change after a rebalancing cycle, so the server needs all cells
+    bool rebalancing = rebalance_interval > 0 && (cycle + 1) % rebalance_interval == 0;
+    return full_sync || rebalancing || cycle >= timesteps - 1;
+};
+
+void BoardServer::notifyLogon(int client_id) {
+    ClientInfo *client = clients[client_id];
+    int start_x, start_y, end_x, end_y;
+    calculateArea(client_id, start_x, start_y, end_x, end_y);
+
+    alignas(8) char buffer[MAX_MESSAGE_SIZE];
+    LogonMessage *rep = LogonMessage::createReply(buffer, client->logon_sequence_number, client_id, start_x, start_y,
+                                                  end_x, end_y, this->timesteps, board_read->getWidth(),
+                                                  board_read->getHeight(), full_sync, rebalance_interval);
+
+    // the neighbours above and below in the grid, the clients only exchange rows with them,
+    // if the areas span whole rows
+    ClientInfo *upper = clients[balancer.getNeighbour(client_id, -1)];
+    ClientInfo *lower = clients[balancer.getNeighbour(client_id, 1)];
+    rep->upper_peer_id = upper->client_id;
+    rep->upper_peer = IPAddress(*upper->address);
+    rep->upper_peer.setPort(upper->peer_port);
+    rep->lower_peer_id = lower->client_id;
+    rep->lower_peer = IPAddress(*lower->address);
+    rep->lower_peer.setPort(lower->peer_port);
+    rep->peer_halos = peer_halos;
+    rep->group = group;
+
+    client->net->queueReply(*client->address, rep, sizeof(LogonMessage));
+};
+
+void BoardServer::barrier(int client_id, unsigned int barrier_sequence_number, int completed_timestep,
+                          int64_t step_time, bool group_member) {
+    // validate client id, clients only reach the barrier after all of them logged on
+    if (!registered || client_id < 0 || (size_t)client_id >= client_count) {
         LOG(WARN) << "Received barrier message with invalid client id " << client_id;
         return;
     }
 
-    clients[client_id]->last_sequence_number = barrier_sequence_number;
-    clients[client_id]->last_completed_timestep = completed_timestep;
+    // every client is counted once per timestep, the requests of a client are handled one after another
+    ClientInfo *client = clients[client_id];
+    if (completed_timestep != timestep || client->last_completed_timestep >= completed_timestep) {
+        return;
+    }
+    client->last_sequence_number = barrier_sequence_number;
+    client->last_completed_timestep = completed_timestep;
+    client->group_member = group_member;
+    balancer.addStepTime(client_id, step_time);
 
     LOG(INFO) << "Client with id " << client_id << " is done with step " << completed_timestep;
 
-    // check if all clients are done
-    if (clients.size() < client_count) {
+    // only the last client of the timestep goes on, the others wait for its release
+    if (++arrivals < (int)client_count) {
         return;
     }
-
-    for (auto client : clients) {
-        if (client->last_completed_timestep < timestep) {
-            return;
-        }
-    }
+    arrivals = 0;
+    std::lock_guard<std::mutex> lock(barrier_mutex);
 
     // all clients are done, swap boards and signal clients to continue
     LOG(INFO) << "All clients have completed step " << timestep;
     timestep += 1;
-    board_read->clear();
-    for (int x = 0; x < board_write->getWidth(); x++) {
-        for (int y = 0; y < board_write->getHeight(); y++) {
-            board_read->setPos(x, y, board_write->getPos(x, y));
-        }
+    board_read->swap(board_write);
+
+    // move rows from slow to fast clients, the clients read their new areas from the board
+    bool rebalanced =
+        rebalance_interval > 0 && timestep % rebalance_interval == 0 && timestep < timesteps && balancer.rebalance();
+    if (rebalanced) {
+        LOG(INFO) << "Rebalanced the areas of the clients after step " << timestep - 1;
     }
-    board_write->clear();
-    notifyAll();
+
+    // clients write only the rows and columns their neighbours read in most cycles,
+    // so the rest of the area has to be cleared
+    if (!isWholeAreaWritten(timestep)) {
+        board_write->clear();
+    }
+    notifyAll(rebalanced);
     stopwatch.stop();
+    if (timestep >= timesteps) {
+        finished.notify_all();
+    }
 };
 
-void BoardServer::notify(int client_id) {
-    BarrierMessage *rep = BarrierMessage::createReply(clients[client_id]->last_sequence_number, client_id);
-    net->reply(*clients[client_id]->address, rep, sizeof(BarrierMessage));
-    delete rep;
+void BoardServer::notify(int client_id, bool group_release) {
+    alignas(8) char buffer[MAX_MESSAGE_SIZE];
+    int start_x, start_y, end_x, end_y;
+    calculateArea(client_id, start_x, start_y, end_x, end_y);
+    BarrierMessage *rep = BarrierMessage::createReply(buffer, clients[client_id]->last_sequence_number, client_id,
+                                                      start_x, start_y, end_x, end_y);
+
+    // the reply is still kept, in case the client lost the message to the group
+    if (group_release) {
+        clients[client_id]->net->queueGroupReply(*clients[client_id]->address, rep, sizeof(BarrierMessage));
+    } else {
+        clients[client_id]->net->queueReply(*clients[client_id]->address, rep, sizeof(BarrierMessage));
+    }
 };
 
-void BoardServer::notifyAll() {
+void BoardServer::notifyAll(bool areas_changed) {
+    // the server is gone after the last cycle, so a lost release could not be sent again
+    bool use_group = group.getPort() != 0 && !areas_changed && timestep < timesteps;
+    bool group_released = false;
     for (ClientInfo *client : clients) {
-        notify(client->client_id);
+        notify(client->client_id, use_group && client->group_member);
+        group_released |= use_group && client->group_member;
+    }
+
+    // the release carries no area, so the clients keep theirs
+    if (group_released) {
+        alignas(8) char buffer[MAX_MESSAGE_SIZE];
+        BarrierMessage *release = BarrierMessage::createRelease(buffer, timestep - 1);
+        nets[0]->sendGroup(group, release, sizeof(BarrierMessage));
+    }
+
+    // all replies of a network are sent at once
+    for (IPNetwork *net : nets) {
+        net->flush();
     }
 };
@@ -1,5 +1,6 @@
 #include "board/BoardServerMPI.h"
 #include "misc/Log.h"
+#include <algorithm>
 
 BoardServerMPI::BoardServerMPI(Board *board_read, Board *board_write, int timesteps)
     : board_read(board_read), board_write(board_write), timesteps(timesteps) {}
@@ -11,17 +12,23 @@ void BoardServerMPI::start(Stopwatch *stopwatch) {
         stopwatch->start();
     }
 
+    int size = 0;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    balancer = LoadBalancer(board_read->getWidth(), board_read->getHeight(), size - 1);
+
     broadcast_timesteps();
     send_areas(true);
 
+    // the messages are matched by rank and tag, so the cycles need no further synchronisation
     while (current_timestep < timesteps) {
-        barrier();
         receive_areas();
         swap_boards();
-        barrier();
+        if (is_rebalance_step()) {
+            rebalance();
+        }
         send_areas(false);
 
-        current_timestep++;
+        current_timestep += get_generations();
 
         board_read->setCurrentStep(current_timestep);
         board_write->setCurrentStep(current_timestep);
@@ -32,19 +39,33 @@ void BoardServerMPI::start(Stopwatch *stopwatch) {
 }
 
 void BoardServerMPI::swap_boards() {
-    board_read->clear();
-    for (int x = 0; x < board_read->getWidth(); x++) {
-        for (int y = 0; y < board_read->getHeight(); y++) {
-            board_read->setPos(x, y, board_write->getPos(x, y));
-        }
-    }
-    board_write->clear();
+    // the areas of the clients cover the whole board and are received completely every cycle,
+    // so the write board does not need to be cleared
+    board_read->swap(board_write);
 }
 
 void BoardServerMPI::broadcast_timesteps() {
     int root = 0;
     MPI_Comm_rank(MPI_COMM_WORLD, &root);
     MPI_Bcast(&timesteps, 1, MPI_INT, root, MPI_COMM_WORLD);
+    MPI_Bcast(&rebalance_interval, 1, MPI_INT, root, MPI_COMM_WORLD);
+    MPI_Bcast(&halo_depth, 1, MPI_INT, root, MPI_COMM_WORLD);
+}
+
+int BoardServerMPI::get_generations() { return std::min(halo_depth, timesteps - current_timestep); }
+
+bool BoardServerMPI::is_rebalance_step() {
+    // the clients decide the same way, whether they get their bounds again after an exchange.
+    // An exchange rebalances, if a multiple of the interval lies within its generations
+    int next_timestep = current_timestep + get_generations();
+    return rebalance_interval > 0 && next_timestep / rebalance_interval != current_timestep / rebalance_interval &&
+           next_timestep < timesteps;
+}
+
+void BoardServerMPI::rebalance() {
+    if (balancer.rebalance()) {
+        LOG(INFO) << "Rebalanced the areas of the clients after step " << current_timestep;
+    }
 }
 
 void BoardServerMPI::receive_areas() {
@@ -68,23 +89,22 @@ void BoardServerMPI::receive_area(int rank) {
     int width = end_x - start_x;
     int height = end_y - start_y;
 
-    int buffer_size = 0;
-    MPI_Pack_size(width * height, MPI_CHAR, MPI_COMM_WORLD, &buffer_size);
+    int time_size = 0;
+    MPI_Pack_size(1, MPI_INT64_T, MPI_COMM_WORLD, &time_size);
+    int buffer_size = time_size + CellPacker::packSize(width, height);
 
-    char *buffer = new char[buffer_size];
+    char *buffer = get_pack_buffer(buffer_size);
     bzero(buffer, buffer_size);
     MPI_Recv(buffer, buffer_size, MPI_PACKED, rank, 3, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
 
+    // the time the client needed for the cycle comes first
     int unpack_count = 0;
-    for (int x = start_x; x < end_x; x++) {
-        for (int y = start_y; y < end_y; y++) {
-            char life_state_byte = 0;
-            MPI_Unpack(buffer, buffer_size, &unpack_count, &life_state_byte, 1, MPI_CHAR, MPI_COMM_WORLD);
-            board_write->setPos(x, y, (life_status_t)life_state_byte);
-        }
-    }
+    int64_t step_time = 0;
+    MPI_Unpack(buffer, buffer_size, &unpack_count, &step_time, 1, MPI_INT64_T, MPI_COMM_WORLD);
+    balancer.addStepTime(rank - 1, step_time);
 
-    delete[] buffer;
+    // the client may send the changes to its area since the last exchange, which the read board still holds
+    cell_packer.unpack(board_write, start_x, start_y, width, height, buffer, buffer_size, unpack_count, board_read);
 }
 
 void BoardServerMPI::send_areas(bool first_pass) {
@@ -94,103 +114,87 @@ void BoardServerMPI::send_areas(bool first_pass) {
     MPI_Comm_size(MPI_COMM_WORLD, &size);
     MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
 
+    // after rebalancing every client gets its bounds, and the whole area if they changed
+    bool rebalanced = !first_pass && is_rebalance_step();
     for (int i = 0; i < size; i++) {
         if (i == my_rank)
             continue;
-        send_area(i, first_pass);
+        if (first_pass || rebalanced) {
+            send_bounds(i);
+        }
+        if (first_pass && clients_load_input) {
+            continue;
+        }
+        send_area(i, first_pass || (rebalanced && balancer.hasMoved(i - 1)));
     }
 }
 
-void BoardServerMPI::send_area(int rank, bool first_pass) {
+void BoardServerMPI::send_bounds(int rank) {
+    int start_x, start_y, end_x, end_y;
+    calculate_area(rank, start_x, start_y, end_x, end_y);
+
+    int buffer_size = 0;
+    MPI_Pack_size(4, MPI_INT, MPI_COMM_WORLD, &buffer_size);
+
+    char *buffer = get_pack_buffer(buffer_size);
+    bzero(buffer, buffer_size);
+    int pack_counter = 0;
+
+    MPI_Pack(&start_x, 1, MPI_INT, buffer, buffer_size, &pack_counter, MPI_COMM_WORLD);
+    MPI_Pack(&start_y, 1, MPI_INT, buffer, buffer_size, &pack_counter, MPI_COMM_WORLD);
+    MPI_Pack(&end_x, 1, MPI_INT, buffer, buffer_size, &pack_counter, MPI_COMM_WORLD);
+    MPI_Pack(&end_y, 1, MPI_INT, buffer, buffer_size, &pack_counter, MPI_COMM_WORLD);
+
+    MPI_Send(buffer, pack_counter, MPI_PACKED, rank, 1, MPI_COMM_WORLD);
+}
+
+void BoardServerMPI::send_area(int rank, bool whole_area) {
     int start_x, start_y, end_x, end_y;
     calculate_area(rank, start_x, start_y, end_x, end_y);
 
     int width = end_x - start_x;
     int height = end_y - start_y;
 
-    if (first_pass) {
+    int outer_width = width + 2 * halo_depth;
+    int outer_height = height + 2 * halo_depth;
+    if (whole_area) {
         // send board area and surroundings
 
-        int buffer_size = 0;
-        MPI_Pack_size(4, MPI_INT, MPI_COMM_WORLD, &buffer_size);
-
-        char *buffer = new char[buffer_size];
-        bzero(buffer, buffer_size);
+        int buffer_size = CellPacker::packSize(outer_width, outer_height);
+        char *buffer = get_pack_buffer(buffer_size);
         int pack_counter = 0;
-
-        MPI_Pack(&start_x, 1, MPI_INT, buffer, buffer_size, &pack_counter, MPI_COMM_WORLD);
-        MPI_Pack(&start_y, 1, MPI_INT, buffer, buffer_size, &pack_counter, MPI_COMM_WORLD);
-        MPI_Pack(&end_x, 1, MPI_INT, buffer, buffer_size, &pack_counter, MPI_COMM_WORLD);
-        MPI_Pack(&end_y, 1, MPI_INT, buffer, buffer_size, &pack_counter, MPI_COMM_WORLD);
-
-        MPI_Send(buffer, pack_counter, MPI_PACKED, rank, 1, MPI_COMM_WORLD);
-        delete[] buffer;
-
-        buffer_size = 0;
-        MPI_Pack_size((width + 2) * (height + 2), MPI_CHAR, MPI_COMM_WORLD, &buffer_size);
-
-        buffer = new char[buffer_size];
-        bzero(buffer, buffer_size);
-        pack_counter = 0;
-        for (int x = start_x - 1; x < end_x + 1; x++) {
-            for (int y = start_y - 1; y < end_y + 1; y++) {
-                char life_state_byte = (char)board_read->getPos(x, y);
-                MPI_Pack(&life_state_byte, 1, MPI_CHAR, buffer, buffer_size, &pack_counter, MPI_COMM_WORLD);
-            }
-        }
+        cell_packer.pack(board_read, start_x - halo_depth, start_y - halo_depth, outer_width, outer_height, buffer,
+                         buffer_size, pack_counter);
         MPI_Send(buffer, pack_counter, MPI_PACKED, rank, 2, MPI_COMM_WORLD);
-        delete[] buffer;
     } else {
-        // send just the surroundings of the board area
-
-        int buffer_size = 0;
-        MPI_Pack_size((width + 2) * 2 + (height + 2) * 2, MPI_CHAR, MPI_COMM_WORLD, &buffer_size);
+        // send just the surroundings of the board area, halo_depth rows and columns on every side:
+        // the rows above and below including the corners, then the columns left and right
 
-        char *buffer = new char[buffer_size];
-        bzero(buffer, buffer_size);
+        int buffer_size =
+            2 * CellPacker::packSize(outer_width, halo_depth) + 2 * CellPacker::packSize(halo_depth, height);
+        char *buffer = get_pack_buffer(buffer_size);
         int pack_counter = 0;
-
-        for (int x = start_x - 1; x < end_x + 1; x++) {
-            char life_state_byte_up = (char)board_read->getPos(x, start_y - 1);
-            char life_state_byte_down = (char)board_read->getPos(x, end_y);
-            MPI_Pack(&life_state_byte_up, 1, MPI_CHAR, buffer, buffer_size, &pack_counter, MPI_COMM_WORLD);
-            MPI_Pack(&life_state_byte_down, 1, MPI_CHAR, buffer, buffer_size, &pack_counter, MPI_COMM_WORLD);
-        }
-
-        for (int y = start_y - 1; y < end_y + 1; y++) {
-            char life_state_byte_left = (char)board_read->getPos(start_x - 1, y);
-            char life_state_byte_right = (char)board_read->getPos(end_x, y);
-            MPI_Pack(&life_state_byte_left, 1, MPI_CHAR, buffer, buffer_size, &pack_counter, MPI_COMM_WORLD);
-            MPI_Pack(&life_state_byte_right, 1, MPI_CHAR, buffer, buffer_size, &pack_counter, MPI_COMM_WORLD);
-        }
-
+        cell_packer.pack(board_read, start_x - halo_depth, start_y - halo_depth, outer_width, halo_depth, buffer,
+                         buffer_size, pack_counter);
+        cell_packer.pack(board_read, start_x - halo_depth, end_y, outer_width, halo_depth, buffer, buffer_size,
+                         pack_counter);
+        cell_packer.pack(board_read, start_x - halo_depth, start_y, halo_depth, height, buffer, buffer_size,
+                         pack_counter);
+        cell_packer.pack(board_read, end_x, start_y, halo_depth, height, buffer, buffer_size, pack_counter);
         MPI_Send(buffer, pack_counter, MPI_PACKED, rank, 2, MPI_COMM_WORLD);
-        delete[] buffer;
     }
 }
 
-void BoardServerMPI::barrier() { MPI_Barrier(MPI_COMM_WORLD); }
+char *BoardServerMPI::get_pack_buffer(int buffer_size) {
+    if (pack_buffer.size() < (size_t)buffer_size) {
+        pack_buffer.resize(buffer_size);
+    }
+    return pack_buffer.data();
+}
 
 void BoardServerMPI::calculate_area(int rank, int &start_x, int &start_y, int &end_x, int &end_y) {
-    // rows are evenly distributed among clients.
-    // If it can not be evenly distributed, early clients get a row more than later clients.
-    // Example: 100 rows, 7 clients, 0 = 15, 1 = 15, 2 to 6 = 14
-
-    int comm_world_size = 0;
-    MPI_Comm_size(MPI_COMM_WORLD, &comm_world_size);
-
-    int client_id = rank - 1;
-    int clients = comm_world_size - 1;
-    int rows = board_read->getHeight();
-
-    int rows_per_client = rows / clients;
-    int rows_per_client_remainder = rows % clients;
-
-    int already_used_rows = client_id * rows_per_client + min(client_id, rows_per_client_remainder);
-    int rows_used_by_this_client = rows_per_client + (client_id < rows_per_client_remainder ? 1 : 0);
-
-    start_x = 0;
-    start_y = already_used_rows;
-    end_x = board_read->getWidth();
-    end_y = start_y + rows_used_by_this_client;
-}
\ No newline at end of file
+    // the board is split into a grid of blocks with evenly distributed rows and columns at the start,
+    // see LoadBalancer. Afterwards the rows of the grid follow the speed of the clients, if rebalancing is enabled.
+    // Example: 100 x 100 cells, 4 clients, 2 x 2 blocks of 50 x 50 cells
+    balancer.getArea(rank - 1, start_x, start_y, end_x, end_y);
+}
@@ -0,0 +1,113 @@
+#include "board/LoadBalancer.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+ * Splits a length into parts, the first parts get one more, if it can not be split evenly.
+ * Returns the start of every part, followed by the length.
+ */
+static std::vector<int> splitEvenly(int length, int parts) {
+    std::vector<int> starts(parts + 1);
+    int per_part = parts > 0 ? length / parts : 0;
+    int remainder = parts > 0 ? length % parts : 0;
+    for (int part = 0; part <= parts; part++) {
+        starts[part] = part * per_part + std::min(part, remainder);
+    }
+    return starts;
+}
+
+LoadBalancer::LoadBalancer(int width, int height, int blocks) : rows(height), step_times(blocks, 0) {
+    chooseGrid(width, height, blocks, grid_rows, grid_columns);
+    starts = splitEvenly(height, grid_rows);
+    column_starts = splitEvenly(width, grid_columns);
+    previous_starts = starts;
+}
+
+bool LoadBalancer::chooseGrid(int width, int height, int blocks, int &grid_rows, int &grid_columns) {
+    grid_rows = blocks;
+    grid_columns = 1;
+    bool found = false;
+    int64_t best_cost = 0;
+    for (int columns = 1; columns <= blocks; columns++) {
+        int rows = blocks / columns;
+        if (blocks % columns != 0 || rows > height || columns > width) {
+            continue;
+        }
+
+        // cells read from other blocks every cycle, the left and right borders of whole rows wrap around.
+        // On a tie the grid with less columns wins
+        int64_t cost = (int64_t)rows * width + (columns > 1 ? (int64_t)columns * height : 0);
+        if (!found || cost < best_cost) {
+            found = true;
+            best_cost = cost;
+            grid_rows = rows;
+            grid_columns = columns;
+        }
+    }
+    return found;
+}
+
+void LoadBalancer::getArea(int block, int &start_x, int &start_y, int &end_x, int &end_y) {
+    int band = block / grid_columns;
+    int column = block % grid_columns;
+    start_x = column_starts[column];
+    start_y = starts[band];
+    end_x = column_starts[column + 1];
+    end_y = starts[band + 1];
+}
+
+int LoadBalancer::getNeighbour(int block, int grid_rows_below) {
+    int band = ((block / grid_columns + grid_rows_below) % grid_rows + grid_rows) % grid_rows;
+    return band * grid_columns + block % grid_columns;
+}
+
+void LoadBalancer::addStepTime(int block, int64_t step_time) {
+    if (block >= 0 && (size_t)block < step_times.size()) {
+        step_times[block] += step_time;
+    }
+}
+
+bool LoadBalancer::rebalance() {
+    int bands = grid_rows;
+    previous_starts = starts;
+
+    // a row of the grid has to wait for its slowest block
+    std::vector<int64_t> band_times(bands, 0);
+    for (size_t block = 0; block < step_times.size(); block++) {
+        int band = (int)block / grid_columns;
+        band_times[band] = std::max(band_times[band], step_times[block]);
+    }
+    std::fill(step_times.begin(), step_times.end(), 0);
+
+    int64_t min_time = 0, max_time = 0;
+    double total_speed = 0;
+    for (int band = 0; band < bands; band++) {
+        min_time = band == 0 ? band_times[band] : std::min(min_time, band_times[band]);
+        max_time = std::max(max_time, band_times[band]);
+        if (band_times[band] > 0) {
+            total_speed += (double)(starts[band + 1] - starts[band]) / band_times[band];
+        }
+    }
+
+    // without a measurement for every band or an empty band, the speed of a client is unknown
+    bool balanced = bands == 0 || rows < bands || min_time <= 0 || max_time <= min_time * (1 + TOLERANCE);
+    if (balanced) {
+        return false;
+    }
+
+    // a band ends where the speed of the clients before it covers its share of the rows, every band keeps a row.
+    // The borders move only half the way, since the measured times are noisy
+    bool changed = false;
+    double speed = 0;
+    int start = 0;
+    for (int band = 0; band < bands - 1; band++) {
+        speed += (double)(starts[band + 1] - start) / band_times[band];
+        int end = (int)std::lround((rows * speed / total_speed + starts[band + 1]) / 2);
+        end = std::max(end, starts[band] + 1);
+        end = std::min(end, rows - (bands - band - 1));
+        start = starts[band + 1];
+        changed = changed || end != starts[band + 1];
+        starts[band + 1] = end;
+    }
+    return changed;
+}
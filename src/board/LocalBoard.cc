@@ -1,11 +1,62 @@
+#include <climits>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <thread>
 #include <vector>
 
 #include "board/LocalBoard.h"
+#include "board/Macrocell.h"
+
+// files smaller than this are decoded on the calling thread, threads would not pay off
+static const size_t PARALLEL_IMPORT_MIN_BYTES = 1 << 20;
+
+// layout of the row index: magic, width, height, size and modification time (in nanoseconds) of the indexed file,
+// followed by one entry per row (and a sentinel entry for the end of the data) made of the byte offset and the row
+// the data there starts in
+static const char INDEX_MAGIC[8] = {'G', 'O', 'L', 'I', 'D', 'X', '2', '\n'};
+static const int64_t INDEX_HEADER_SIZE = sizeof(INDEX_MAGIC) + 2 * sizeof(int) + 2 * sizeof(int64_t);
+static const int64_t INDEX_ENTRY_SIZE = sizeof(int64_t) + sizeof(int);
+
+// macrocell patterns with more cells than this are only imported partially
+static const int64_t MAX_MACROCELL_IMPORT_CELLS = (int64_t)1 << 28;
+
+/**
+ * Gets the time a file was modified last, in nanoseconds, or -1 if the file does not exist.
+ */
+static int64_t modificationTime(const std::string &fileName) {
+    struct stat status;
+    if (stat(fileName.c_str(), &status) != 0) {
+        return -1;
+    }
+    return (int64_t)status.st_mtim.tv_sec * 1000000000 + status.st_mtim.tv_nsec;
+}
+
+static bool isMacrocell(const std::string &fileName) {
+    return fileName.length() > 3 && fileName.compare(fileName.length() - 3, 3, ".mc") == 0;
+}
+
+// The area of a macrocell pattern which forms the board: the stored board size, else the bounding box.
+static bool macrocellArea(Macrocell &pattern, int64_t &area_x, int64_t &area_y, int64_t &area_width,
+                          int64_t &area_height) {
+    area_x = 0;
+    area_y = 0;
+    if (pattern.getBoardSize(area_width, area_height)) {
+        return true;
+    }
+
+    int64_t end_x, end_y;
+    if (!pattern.boundingBox(area_x, area_y, end_x, end_y)) {
+        return false;
+    }
+    area_width = end_x - area_x;
+    area_height = end_y - area_y;
+    return true;
+}
 
 LocalBoard::LocalBoard(int width, int height) : Board(width, height), field(width * height, life_status_t::dead) {
     if (width * height <= 0) {
@@ -36,9 +87,16 @@ enum life_status_t LocalBoard::getPos(int x, int y) {
 }
 
 void LocalBoard::step() {
-    std::vector<enum life_status_t> newField = std::vector<life_status_t>(width * height, life_status_t::dead);
-    for (int x = 0; x < width; x++) {
-        for (int y = 0; y < height; y++) {
+    stepRegion(0, 0, width, height);
+    completeStep();
+}
+
+void LocalBoard::stepRegion(int start_x, int start_y, int end_x, int end_y) {
+    // the buffer of the last step is reused without clearing it, the caller computes every cell it needs
+    std::vector<enum life_status_t> &newField = next_field;
+    newField.resize((size_t)width * height, life_status_t::dead);
+    for (int x = std::max(start_x, 0); x < std::min(end_x, width); x++) {
+        for (int y = std::max(start_y, 0); y < std::min(end_y, height); y++) {
             int neighbourCount = 0;
             enum life_status_t status = getPos(x, y);
             for (int dx = -1; dx <= 1; dx++) {
@@ -62,11 +120,22 @@ void LocalBoard::step() {
             }
         }
     }
-    for (int x = 0; x < width; x++) {
-        for (int y = 0; y < height; y++) {
-            setPosRaw(x, y, newField[y * width + x]);
-        }
+}
+
+void LocalBoard::stepFrame(int start_x, int start_y, int end_x, int end_y, int thickness) {
+    if (end_x <= start_x || end_y <= start_y) {
+        return;
     }
+    int inner_start_y = std::min(start_y + thickness, end_y);
+    int inner_end_y = std::max(end_y - thickness, inner_start_y);
+    stepRegion(start_x, start_y, end_x, inner_start_y);
+    stepRegion(start_x, inner_end_y, end_x, end_y);
+    stepRegion(start_x, inner_start_y, std::min(start_x + thickness, end_x), inner_end_y);
+    stepRegion(std::max(end_x - thickness, start_x + thickness), inner_start_y, end_x, inner_end_y);
+}
+
+void LocalBoard::completeStep() {
+    field.swap(next_field);
     currentStep += 1;
 }
 
@@ -75,6 +144,12 @@ void LocalBoard::setPosRaw(int x, int y, enum life_status_t status) { field[y *
 enum life_status_t LocalBoard::getPosRaw(int x, int y) { return field[y * width + x]; }
 
 bool LocalBoard::exportAll(std::string destFileName) {
+    if (isMacrocell(destFileName)) {
+        Macrocell pattern;
+        pattern.fromBoard(this);
+        return pattern.write(destFileName);
+    }
+
     std::ofstream outBoardFile(destFileName);
 
     outBoardFile << "x = " << this->width << ", y = " << this->height << std::endl;
@@ -114,129 +189,476 @@ bool LocalBoard::importAll(std::string sourceFileName) {
         return true;
     }
 
-    std::ifstream boardFile(sourceFileName);
+    if (isMacrocell(sourceFileName)) {
+        Macrocell pattern;
+        if (!pattern.read(sourceFileName)) {
+            return false;
+        }
+
+        int64_t area_x, area_y, area_width, area_height;
+        if (!macrocellArea(pattern, area_x, area_y, area_width, area_height)) {
+            // empty pattern without a stored size, keep the current size
+            clear();
+            return true;
+        }
+
+        if (area_width > INT_MAX || area_height > INT_MAX || area_width * area_height > MAX_MACROCELL_IMPORT_CELLS) {
+            LOG(WARN) << "Pattern '" << sourceFileName << "' has " << area_width << " * " << area_height
+                      << " cells, importing only its upper left " << width << " * " << height << " cells";
+        } else {
+            this->width = (int)area_width;
+            this->height = (int)area_height;
+        }
+
+        field.assign((size_t)width * height, life_status_t::dead);
+        pattern.rasterize(this, 0, 0, area_x, area_y, area_width, area_height);
+        return true;
+    }
+
+    std::ifstream boardFile(sourceFileName, std::ios::binary);
     if (!boardFile.good())
         return false;
 
-    int written_cells_this_line = 0;
-    int line_number = -1;
+    int x_size = -1, y_size = -1;
+    if (!parseRLEHeader(boardFile, x_size, y_size)) {
+        LOG(DEBUG) << "Read invalid board sizes (" << x_size << "," << y_size << ") from file '" << sourceFileName
+                   << "'.";
+        return false;
+    }
+
+    this->width = x_size;
+    this->height = y_size;
+
+    field.assign((size_t)width * height, life_status_t::dead);
+
+    // read the remaining pattern data with a single read
+    std::streampos data_start = boardFile.tellg();
+    boardFile.seekg(0, std::ios::end);
+    std::streampos data_end = boardFile.tellg();
+    if (data_start < 0 || data_end <= data_start) {
+        return true;
+    }
+    std::string data((size_t)(data_end - data_start), '\0');
+    boardFile.seekg(data_start);
+    boardFile.read(&data[0], data.size());
+    boardFile.close();
+
+    // free text may follow the pattern, it must not be split into chunks or decoded
+    const char *begin = data.data();
+    const char *end = findPatternEnd(begin, begin + data.size());
+
+    unsigned int thread_count = std::thread::hardware_concurrency();
+    if ((size_t)(end - begin) < PARALLEL_IMPORT_MIN_BYTES || thread_count <= 1) {
+        decodeRLE(begin, end, 0);
+        return true;
+    }
+
+    // first pass: split the data at row terminators into one chunk per thread
+    std::vector<const char *> chunk_starts;
+    chunk_starts.push_back(begin);
+    size_t chunk_size = (end - begin) / thread_count;
+    for (unsigned int i = 1; i < thread_count; i++) {
+        const char *cursor = std::max(chunk_starts.back(), begin + i * chunk_size);
+
+        // the split must not fall into a comment, so the line of the cursor is checked from its start on
+        const char *line_start = cursor;
+        while (line_start > chunk_starts.back() && line_start[-1] != '\n') {
+            --line_start;
+        }
+        cursor = findRowTerminator(line_start, cursor, end);
+        if (cursor == end) {
+            break;
+        }
+        chunk_starts.push_back(cursor + 1);
+    }
+    chunk_starts.push_back(end);
+    size_t chunk_count = chunk_starts.size() - 1;
+
+    // count the rows of every chunk in parallel, the prefix sum is the starting row of each chunk
+    std::vector<int> chunk_rows(chunk_count, 0);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < chunk_count; i++) {
+        workers.emplace_back([&, i]() { chunk_rows[i] = countRLERows(chunk_starts[i], chunk_starts[i + 1]); });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    // second pass: decode every chunk in parallel directly into its own rows
+    int start_row = 0;
+    for (size_t i = 0; i < chunk_count; i++) {
+        workers.emplace_back([this, &chunk_starts, i, start_row]() {
+            decodeRLE(chunk_starts[i], chunk_starts[i + 1], start_row);
+        });
+        start_row += chunk_rows[i];
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    return true;
+}
+
+bool LocalBoard::parseRLEHeader(std::istream &boardFile, int &x_size, int &y_size) {
+    // parse the header line, skipping empty lines and comments in front of it
     std::string line;
     while (getline(boardFile, line)) {
-        int line_length = (int)line.length();
-
-        if (line_length < 1 or line[0] == '#') {
+        if (line.length() < 1 or line[0] == '#' or line[0] == '\r') {
             continue;
         }
 
-        // first line, attempt to parse board sizes
-        if (line_number == -1) {
-            // remove all spaces in line to make parsing it easier
-            std::string::iterator end_pos = std::remove(line.begin(), line.end(), ' ');
-            line.erase(end_pos, line.end());
-            int x_size = -1, y_size = -1;
-            size_t pos = 0;
-            std::string delimiter = ",";
-            std::string token;
-
-            // try catch, because we parse user input directly with std::stoi, which can throw exceptions if its not a
-            // number
-            try {
-                std::vector<string> tokens;
-                while ((pos = line.find(delimiter)) != std::string::npos) {
-                    token = line.substr(0, pos);
-                    tokens.push_back(token);
-                    line.erase(0, pos + delimiter.length());
-                }
-                tokens.push_back(line);
-                for (string token : tokens) {
-                    if (token.rfind("x=") == 0) {
-                        token.erase(0, 2);
-                        x_size = std::stoi(token);
-                    } else if (token.rfind("y=") == 0) {
-                        token.erase(0, 2);
-                        y_size = std::stoi(token);
-                    }
+        // remove all spaces in line to make parsing it easier
+        std::string::iterator end_pos = std::remove(line.begin(), line.end(), ' ');
+        line.erase(end_pos, line.end());
+        size_t pos = 0;
+        std::string delimiter = ",";
+        std::string token;
+
+        // try catch, because we parse user input directly with std::stoi, which can throw exceptions if its not a
+        // number
+        try {
+            std::vector<string> tokens;
+            while ((pos = line.find(delimiter)) != std::string::npos) {
+                token = line.substr(0, pos);
+                tokens.push_back(token);
+                line.erase(0, pos + delimiter.length());
+            }
+            tokens.push_back(line);
+            for (string token : tokens) {
+                if (token.rfind("x=") == 0) {
+                    token.erase(0, 2);
+                    x_size = std::stoi(token);
+                } else if (token.rfind("y=") == 0) {
+                    token.erase(0, 2);
+                    y_size = std::stoi(token);
                 }
-            } catch (...) {
-                return false;
             }
+        } catch (...) {
+            return false;
+        }
 
-            if (x_size <= 0 || y_size <= 0) {
-                LOG(DEBUG) << "Read invalid board sizes (" << x_size << "," << y_size << ") from file '"
-                           << sourceFileName << "'.";
-                return false;
-            }
+        return x_size > 0 && y_size > 0;
+    }
+    return false;
+}
 
-            this->width = x_size;
-            this->height = y_size;
+bool LocalBoard::readSize(std::string sourceFileName, int &x_size, int &y_size) {
+    if (isMacrocell(sourceFileName)) {
+        Macrocell pattern;
+        int64_t area_x, area_y, area_width, area_height;
+        if (!pattern.read(sourceFileName) || !macrocellArea(pattern, area_x, area_y, area_width, area_height) ||
+            area_width > INT_MAX || area_height > INT_MAX) {
+            return false;
+        }
+        x_size = (int)area_width;
+        y_size = (int)area_height;
+        return true;
+    }
 
-            field.resize(width * height, life_status_t::dead);
+    std::ifstream boardFile(sourceFileName, std::ios::binary);
+    if (!boardFile.good())
+        return false;
+    return parseRLEHeader(boardFile, x_size, y_size);
+}
 
-            ++line_number;
-            continue;
+bool LocalBoard::buildIndex(std::string sourceFileName) {
+    std::ifstream boardFile(sourceFileName, std::ios::binary);
+    if (!boardFile.good())
+        return false;
+
+    int x_size = -1, y_size = -1;
+    if (!parseRLEHeader(boardFile, x_size, y_size)) {
+        return false;
+    }
+
+    std::ofstream indexFile(sourceFileName + ".idx", std::ios::binary | std::ios::trunc);
+    if (!indexFile.good())
+        return false;
+
+    boardFile.seekg(0, std::ios::end);
+    int64_t file_size = boardFile.tellg();
+    int64_t modification_time = modificationTime(sourceFileName);
+    boardFile.seekg(0);
+
+    // skip the header again, this time without losing the position of the data
+    std::string line;
+    int64_t data_start = 0;
+    while (getline(boardFile, line)) {
+        data_start = boardFile.tellg();
+        if (line.length() > 0 && line[0] != '#' && line[0] != '\r') {
+            break;
         }
+    }
 
-        // all other lines, parse board content
-        if (line_number >= 0) {
-            for (int cursor = 0; cursor < line_length; ++cursor) {
-                int number = -1;
-                if (isdigit(line[cursor])) {
-                    int read_start_index = cursor;
-                    while (isdigit(line[++cursor]))
-                        ;
-                    number = std::stoi(line.substr(read_start_index, read_start_index - cursor));
+    indexFile.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    indexFile.write((const char *)&x_size, sizeof(x_size));
+    indexFile.write((const char *)&y_size, sizeof(y_size));
+    indexFile.write((const char *)&file_size, sizeof(file_size));
+    indexFile.write((const char *)&modification_time, sizeof(modification_time));
+
+    // every row gets the offset of the first token after the terminator of the previous row and the row this
+    // token starts in, which is larger than the row itself if the row is part of a multi row run like '3$'
+    auto writeEntry = [&indexFile](int64_t offset, int start_row) {
+        indexFile.write((const char *)&offset, sizeof(offset));
+        indexFile.write((const char *)&start_row, sizeof(start_row));
+    };
+
+    writeEntry(data_start, 0);
+    int row = 0;
+    int number = 0;
+    int64_t offset = data_start;
+    char buffer[1 << 16];
+    bool comment = false; // comments are skipped like decodeRLE() does, they may contain '$'
+    bool done = false;
+    while (!done) {
+        boardFile.read(buffer, sizeof(buffer));
+        std::streamsize length = boardFile.gcount();
+        if (length <= 0) {
+            break;
+        }
+        for (std::streamsize i = 0; i < length; ++i, ++offset) {
+            char c = buffer[i];
+            if (comment) {
+                comment = c != '\n';
+            } else if (isdigit(c)) {
+                number = number * 10 + (c - '0');
+            } else if (c == '#') {
+                comment = true;
+                number = 0;
+            } else if (c == '$') {
+                int count = number > 0 ? number : 1;
+                for (int r = row + 1; r <= std::min(row + count, y_size); ++r) {
+                    writeEntry(offset + 1, std::min(row + count, y_size));
                 }
+                row = std::min(row + count, y_size);
+                number = 0;
+            } else if (c == '!') {
+                done = true;
+                break;
+            } else if (!isspace(c)) {
+                number = 0;
+            }
+        }
+    }
 
-                if (line[cursor] == 'b') {
-                    if (number == -1) {
-                        this->setPos(written_cells_this_line, line_number, life_status_t::dead);
-                        ++written_cells_this_line;
-                    } else {
-                        for (int i = 0; i < number; ++i) {
-                            this->setPos(written_cells_this_line, line_number, life_status_t::dead);
-                            ++written_cells_this_line;
-                        }
-                    }
-                } else if (line[cursor] == 'o') {
-                    if (number == -1) {
-                        this->setPos(written_cells_this_line, line_number, life_status_t::alive);
-                        ++written_cells_this_line;
-                    } else {
-                        for (int i = 0; i < number; ++i) {
-                            this->setPos(written_cells_this_line, line_number, life_status_t::alive);
-                            ++written_cells_this_line;
-                        }
-                    }
-                }
+    // remaining rows are empty, the sentinel entry for y_size marks the end of the data
+    for (int r = row + 1; r <= y_size; ++r) {
+        writeEntry(offset, y_size);
+    }
 
-                if (line[cursor] == '$') {
-                    if (written_cells_this_line < this->width) {
-                        int diff = this->width - written_cells_this_line;
-                        for (int i = 0; i < diff; ++i) {
-                            this->setPos(written_cells_this_line, line_number, life_status_t::dead);
-                            ++written_cells_this_line;
-                        }
-                    }
-                    written_cells_this_line = 0;
+    return indexFile.good();
+}
 
-                    ++line_number;
-                }
+bool LocalBoard::hasIndex(std::string sourceFileName) {
+    if (isMacrocell(sourceFileName)) {
+        // macrocell patterns allow random access without an index
+        return true;
+    }
+
+    std::ifstream boardFile(sourceFileName, std::ios::binary | std::ios::ate);
+    std::ifstream indexFile(sourceFileName + ".idx", std::ios::binary);
+    if (!boardFile.good() || !indexFile.good())
+        return false;
+
+    char magic[sizeof(INDEX_MAGIC)];
+    int x_size = -1, y_size = -1;
+    int64_t file_size = -1;
+    int64_t modification_time = -1;
+    indexFile.read(magic, sizeof(magic));
+    indexFile.read((char *)&x_size, sizeof(x_size));
+    indexFile.read((char *)&y_size, sizeof(y_size));
+    indexFile.read((char *)&file_size, sizeof(file_size));
+    indexFile.read((char *)&modification_time, sizeof(modification_time));
+    if (!indexFile.good() || memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0) {
+        return false;
+    }
+
+    // an index of a file that changed since it was built is stale, even if the size stayed the same
+    return file_size == (int64_t)boardFile.tellg() && modification_time == modificationTime(sourceFileName);
+}
+
+bool LocalBoard::importWindow(std::string sourceFileName, int origin_x, int origin_y) {
+    if (isMacrocell(sourceFileName)) {
+        // the quadtree allows random access on its own
+        Macrocell pattern;
+        int64_t area_x, area_y, area_width, area_height;
+        if (!pattern.read(sourceFileName) || !macrocellArea(pattern, area_x, area_y, area_width, area_height)) {
+            return false;
+        }
+        clear();
+        pattern.rasterize(this, origin_x, origin_y, area_x, area_y, area_width, area_height);
+        return true;
+    }
+
+    int x_size = -1, y_size = -1;
+    if (!readSize(sourceFileName, x_size, y_size)) {
+        return false;
+    }
+
+    if (!hasIndex(sourceFileName)) {
+        LOG(WARN) << "No valid row index for '" << sourceFileName << "', importing the whole file";
+        LocalBoard source(x_size, y_size);
+        if (!source.importAll(sourceFileName)) {
+            return false;
+        }
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                setPosRaw(x, y, source.getPos(origin_x + x, origin_y + y));
             }
         }
+        return true;
+    }
+
+    std::ifstream boardFile(sourceFileName, std::ios::binary);
+    std::ifstream indexFile(sourceFileName + ".idx", std::ios::binary);
+    auto readEntry = [&indexFile](int row, int64_t &offset, int &start_row) {
+        indexFile.seekg(INDEX_HEADER_SIZE + (int64_t)row * INDEX_ENTRY_SIZE);
+        indexFile.read((char *)&offset, sizeof(offset));
+        indexFile.read((char *)&start_row, sizeof(start_row));
+        return indexFile.good();
+    };
+
+    // the window may wrap around the pattern, so it is loaded as one or more contiguous row ranges
+    int y = 0;
+    while (y < height) {
+        int first_row = ((origin_y + y) % y_size + y_size) % y_size;
+        int rows = std::min(height - y, y_size - first_row);
+
+        int64_t begin_offset, end_offset;
+        int start_row, end_row;
+        if (!readEntry(first_row, begin_offset, start_row) || !readEntry(first_row + rows, end_offset, end_row)) {
+            return false;
+        }
+
+        std::string data((size_t)(end_offset - begin_offset), '\0');
+        boardFile.seekg(begin_offset);
+        boardFile.read(&data[0], data.size());
+
+        LocalBoard band(x_size, rows);
+        band.decodeRLE(data.data(), data.data() + data.size(), start_row - first_row);
+
+        for (int band_y = 0; band_y < rows; band_y++) {
+            for (int x = 0; x < width; x++) {
+                int source_x = ((origin_x + x) % x_size + x_size) % x_size;
+                setPosRaw(x, y + band_y, band.getPosRaw(source_x, band_y));
+            }
+        }
+        y += rows;
     }
 
-    boardFile.close();
     return true;
 }
 
+const char *LocalBoard::findPatternEnd(const char *begin, const char *end) {
+    for (const char *position = begin; position < end; ++position) {
+        if (*position == '#') {
+            position = std::find(position, end, '\n');
+            if (position == end) {
+                break;
+            }
+        } else if (*position == '!') {
+            return position;
+        }
+    }
+    return end;
+}
+
+const char *LocalBoard::findRowTerminator(const char *line_start, const char *cursor, const char *end) {
+    for (const char *position = line_start; position < end; ++position) {
+        if (*position == '#') {
+            position = std::find(position, end, '\n');
+            if (position == end) {
+                break;
+            }
+        } else if (*position == '$' && position >= cursor) {
+            return position;
+        }
+    }
+    return end;
+}
+
+int LocalBoard::countRLERows(const char *begin, const char *end) {
+    int rows = 0;
+    int number = 0;
+    for (const char *cursor = begin; cursor < end; ++cursor) {
+        char c = *cursor;
+        if (isdigit(c)) {
+            number = number * 10 + (c - '0');
+        } else if (c == '$') {
+            rows += number > 0 ? number : 1;
+            number = 0;
+        } else if (c == '!') {
+            break;
+        } else if (c == '#') {
+            // comment, skip until the end of the line
+            cursor = std::find(cursor, end, '\n');
+            number = 0;
+        } else if (!isspace(c)) {
+            number = 0;
+        }
+    }
+    return rows;
+}
+
+void LocalBoard::decodeRLE(const char *begin, const char *end, int row) {
+    int column = 0;
+    int number = 0;
+    for (const char *cursor = begin; cursor < end; ++cursor) {
+        char c = *cursor;
+        if (isdigit(c)) {
+            number = number * 10 + (c - '0');
+            continue;
+        } else if (isspace(c)) {
+            continue;
+        }
+
+        int count = number > 0 ? number : 1;
+        number = 0;
+
+        if (c == 'b' || c == 'o') {
+            if (c == 'o' && row >= 0 && row < height) {
+                int last = std::min(column + count, width);
+                for (int x = std::max(column, 0); x < last; ++x) {
+                    field[(size_t)row * width + x] = life_status_t::alive;
+                }
+            }
+            column += count;
+        } else if (c == '$') {
+            row += count;
+            column = 0;
+        } else if (c == '!') {
+            break;
+        } else if (c == '#') {
+            // comment, skip until the end of the line
+            cursor = std::find(cursor, end, '\n');
+        }
+    }
+}
+
 int LocalBoard::getWidth() { return width; }
 
 int LocalBoard::getHeight() { return height; }
 
-void LocalBoard::clear() {
-    for (int x = 0; x < width; x++) {
-        for (int y = 0; y < height; y++) {
-            setPosRaw(x, y, life_status_t::dead);
-        }
+void LocalBoard::clear() { std::fill(field.begin(), field.end(), life_status_t::dead); }
+
+void LocalBoard::swap(Board *other) {
+    LocalBoard *local = dynamic_cast<LocalBoard *>(other);
+    if (local == nullptr || local->width != width || local->height != height) {
+        Board::swap(other);
+        return;
+    }
+    field.swap(local->field);
+}
+
+void LocalBoard::copyRegion(LocalBoard *source, int start_x, int start_y, int end_x, int end_y) {
+    if (source->width != width || source->height != height) {
+        return;
+    }
+    start_x = std::max(start_x, 0);
+    end_x = std::min(end_x, width);
+    for (int y = std::max(start_y, 0); y < std::min(end_y, height) && start_x < end_x; y++) {
+        std::copy(source->field.begin() + y * width + start_x, source->field.begin() + y * width + end_x,
+                  field.begin() + y * width + start_x);
     }
 }
\ No newline at end of file
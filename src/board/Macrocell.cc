@@ -0,0 +1,358 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "board/Macrocell.h"
+#include "misc/Log.h"
+
+Macrocell::Macrocell() {
+    // index 0 is always the empty node
+    nodes.push_back(MacrocellNode());
+}
+
+bool Macrocell::read(std::string sourceFileName) {
+    std::ifstream mcFile(sourceFileName);
+    if (!mcFile.good())
+        return false;
+
+    std::string line;
+    if (!getline(mcFile, line) || line.rfind("[M2]", 0) != 0) {
+        LOG(DEBUG) << "File '" << sourceFileName << "' is not in the macrocell format.";
+        return false;
+    }
+
+    nodes.resize(1);
+    leaf_ids.clear();
+    node_ids.clear();
+    root = 0;
+    root_level = 3;
+    board_width = -1;
+    board_height = -1;
+
+    // nodes in the file are numbered from 1 in order of appearance, map them to our node indices
+    std::vector<int> file_nodes(1, 0);
+    std::vector<int> file_levels(1, 0);
+    while (getline(mcFile, line)) {
+        if (line.length() < 1 || line[0] == '\r') {
+            continue;
+        }
+
+        if (line[0] == '#') {
+            long long size_x, size_y;
+            if (sscanf(line.c_str(), "#C size %lld %lld", &size_x, &size_y) == 2 && size_x > 0 && size_y > 0) {
+                board_width = size_x;
+                board_height = size_y;
+            } else if (line.rfind("#R", 0) == 0 && line.find("B3/S23") == std::string::npos &&
+                       line.find("b3/s23") == std::string::npos) {
+                LOG(WARN) << "Macrocell rule '" << line.substr(2) << "' is not supported, using B3/S23";
+            }
+            continue;
+        }
+
+        if (line[0] == '.' || line[0] == '*' || line[0] == '$') {
+            // leaf of 8x8 cells, rows end with '$', trailing dead cells and rows are left out
+            uint64_t cells = 0;
+            int x = 0, y = 0;
+            for (char c : line) {
+                if (c == '*' && x < 8 && y < 8) {
+                    cells |= (uint64_t)1 << (y * 8 + x);
+                }
+                if (c == '.' || c == '*') {
+                    x++;
+                } else if (c == '$') {
+                    x = 0;
+                    y++;
+                }
+            }
+            file_nodes.push_back(addLeaf(cells));
+            file_levels.push_back(3);
+            continue;
+        }
+
+        std::istringstream tokens(line);
+        int level;
+        size_t children[4];
+        if (!(tokens >> level >> children[0] >> children[1] >> children[2] >> children[3]) || level < 4 ||
+            level > 62) {
+            LOG(DEBUG) << "Invalid macrocell node '" << line << "' in file '" << sourceFileName << "'.";
+            return false;
+        }
+        for (size_t child : children) {
+            if (child >= file_nodes.size() || (child != 0 && file_levels[child] != level - 1)) {
+                LOG(DEBUG) << "Invalid child reference in macrocell node '" << line << "'.";
+                return false;
+            }
+        }
+        file_nodes.push_back(addNode(level, file_nodes[children[0]], file_nodes[children[1]],
+                                     file_nodes[children[2]], file_nodes[children[3]]));
+        file_levels.push_back(level);
+    }
+
+    // the last node in the file is the root
+    root = file_nodes.back();
+    root_level = std::max(file_levels.back(), 3);
+    return true;
+}
+
+bool Macrocell::write(std::string destFileName) {
+    std::ofstream mcFile(destFileName);
+    if (!mcFile.good())
+        return false;
+
+    mcFile << "[M2] (vps-1 gol)" << std::endl;
+    mcFile << "#R B3/S23" << std::endl;
+    if (board_width > 0 && board_height > 0) {
+        mcFile << "#C size " << board_width << " " << board_height << std::endl;
+    }
+
+    if (root == 0) {
+        // an empty pattern is written as a single empty leaf
+        mcFile << "$" << std::endl;
+        mcFile.close();
+        return true;
+    }
+
+    // only nodes reachable from the root are written, children first and numbered in order of appearance
+    std::vector<int> numbers(nodes.size(), 0);
+    int next_number = 1;
+    writeNode(mcFile, root, numbers, next_number);
+
+    mcFile.close();
+    return true;
+}
+
+int Macrocell::writeNode(std::ostream &mcFile, int node, std::vector<int> &numbers, int &next_number) {
+    if (node == 0 || numbers[node] != 0) {
+        return numbers[node];
+    }
+
+    const MacrocellNode &current = nodes[node];
+    if (current.level == 3) {
+        int last_row = 7;
+        while (last_row >= 0 && ((current.cells >> (last_row * 8)) & 0xff) == 0) {
+            last_row--;
+        }
+        for (int y = 0; y <= last_row; y++) {
+            uint64_t row = (current.cells >> (y * 8)) & 0xff;
+            for (int x = 0; row >> x; x++) {
+                mcFile << (((row >> x) & 1) ? '*' : '.');
+            }
+            mcFile << '$';
+        }
+    } else {
+        int children[4];
+        for (int i = 0; i < 4; i++) {
+            children[i] = writeNode(mcFile, current.children[i], numbers, next_number);
+        }
+        mcFile << current.level << " " << children[0] << " " << children[1] << " " << children[2] << " "
+               << children[3];
+    }
+    mcFile << "\n";
+
+    numbers[node] = next_number++;
+    return numbers[node];
+}
+
+void Macrocell::fromBoard(Board *board) {
+    nodes.resize(1);
+    leaf_ids.clear();
+    node_ids.clear();
+
+    int width = board->getWidth();
+    int height = board->getHeight();
+    board_width = width;
+    board_height = height;
+
+    // build the leaves covering the board, then combine 2x2 blocks of nodes until only the root is left
+    int grid_width = (width + 7) / 8;
+    int grid_height = (height + 7) / 8;
+    std::vector<int> grid((size_t)grid_width * grid_height, 0);
+    for (int grid_y = 0; grid_y < grid_height; grid_y++) {
+        for (int grid_x = 0; grid_x < grid_width; grid_x++) {
+            uint64_t cells = 0;
+            for (int y = 0; y < 8 && grid_y * 8 + y < height; y++) {
+                for (int x = 0; x < 8 && grid_x * 8 + x < width; x++) {
+                    if (board->getPos(grid_x * 8 + x, grid_y * 8 + y) == life_status_t::alive) {
+                        cells |= (uint64_t)1 << (y * 8 + x);
+                    }
+                }
+            }
+            grid[(size_t)grid_y * grid_width + grid_x] = addLeaf(cells);
+        }
+    }
+
+    int level = 3;
+    while (grid_width > 1 || grid_height > 1) {
+        level++;
+        int next_width = (grid_width + 1) / 2;
+        int next_height = (grid_height + 1) / 2;
+        std::vector<int> next((size_t)next_width * next_height, 0);
+        auto at = [&](int x, int y) {
+            return (x < grid_width && y < grid_height) ? grid[(size_t)y * grid_width + x] : 0;
+        };
+        for (int y = 0; y < next_height; y++) {
+            for (int x = 0; x < next_width; x++) {
+                next[(size_t)y * next_width + x] = addNode(level, at(2 * x, 2 * y), at(2 * x + 1, 2 * y),
+                                                          at(2 * x, 2 * y + 1), at(2 * x + 1, 2 * y + 1));
+            }
+        }
+        grid.swap(next);
+        grid_width = next_width;
+        grid_height = next_height;
+    }
+
+    root = grid[0];
+    root_level = level;
+}
+
+void Macrocell::rasterize(Board *board, int64_t origin_x, int64_t origin_y, int64_t area_x, int64_t area_y,
+                          int64_t area_width, int64_t area_height) {
+    if (root == 0) {
+        return;
+    }
+
+    // the window may wrap around the area, so it is split into rectangles which do not
+    int64_t width = board->getWidth();
+    int64_t height = board->getHeight();
+    int64_t y = 0;
+    while (y < height) {
+        int64_t pattern_y = ((origin_y + y) % area_height + area_height) % area_height;
+        int64_t rows = std::min(height - y, area_height - pattern_y);
+        int64_t x = 0;
+        while (x < width) {
+            int64_t pattern_x = ((origin_x + x) % area_width + area_width) % area_width;
+            int64_t columns = std::min(width - x, area_width - pattern_x);
+            rasterizeNode(board, root, root_level, 0, 0, area_x + pattern_x, area_y + pattern_y,
+                          area_x + pattern_x + columns, area_y + pattern_y + rows, x, y);
+            x += columns;
+        }
+        y += rows;
+    }
+}
+
+void Macrocell::rasterizeNode(Board *board, int node, int level, int64_t node_x, int64_t node_y, int64_t start_x,
+                              int64_t start_y, int64_t end_x, int64_t end_y, int64_t board_x, int64_t board_y) {
+    int64_t size = (int64_t)1 << level;
+    if (node == 0 || node_x >= end_x || node_y >= end_y || node_x + size <= start_x || node_y + size <= start_y) {
+        return;
+    }
+
+    if (level == 3) {
+        uint64_t cells = nodes[node].cells;
+        while (cells != 0) {
+            int bit = __builtin_ctzll(cells);
+            cells &= cells - 1;
+            int64_t x = node_x + bit % 8;
+            int64_t y = node_y + bit / 8;
+            if (x >= start_x && x < end_x && y >= start_y && y < end_y) {
+                board->setPos((int)(board_x + x - start_x), (int)(board_y + y - start_y), life_status_t::alive);
+            }
+        }
+        return;
+    }
+
+    int64_t half = size / 2;
+    for (int i = 0; i < 4; i++) {
+        rasterizeNode(board, nodes[node].children[i], level - 1, node_x + (i % 2) * half, node_y + (i / 2) * half,
+                      start_x, start_y, end_x, end_y, board_x, board_y);
+    }
+}
+
+bool Macrocell::boundingBox(int64_t &start_x, int64_t &start_y, int64_t &end_x, int64_t &end_y) {
+    if (root == 0) {
+        return false;
+    }
+
+    // bounding boxes relative to the node origin, shared subtrees are only calculated once
+    std::vector<int64_t> boxes(nodes.size() * 4, 0);
+    for (size_t i = 1; i < nodes.size(); i++) {
+        int64_t *box = &boxes[i * 4];
+        const MacrocellNode &node = nodes[i];
+        if (node.level == 3) {
+            box[0] = box[1] = 8;
+            box[2] = box[3] = 0;
+            for (int bit = 0; bit < 64; bit++) {
+                if ((node.cells >> bit) & 1) {
+                    box[0] = std::min<int64_t>(box[0], bit % 8);
+                    box[1] = std::min<int64_t>(box[1], bit / 8);
+                    box[2] = std::max<int64_t>(box[2], bit % 8 + 1);
+                    box[3] = std::max<int64_t>(box[3], bit / 8 + 1);
+                }
+            }
+            continue;
+        }
+
+        int64_t half = (int64_t)1 << (node.level - 1);
+        box[0] = box[1] = INT64_MAX;
+        box[2] = box[3] = INT64_MIN;
+        for (int c = 0; c < 4; c++) {
+            int child = node.children[c];
+            if (child == 0) {
+                continue;
+            }
+            const int64_t *child_box = &boxes[(size_t)child * 4];
+            int64_t offset_x = (c % 2) * half;
+            int64_t offset_y = (c / 2) * half;
+            box[0] = std::min(box[0], child_box[0] + offset_x);
+            box[1] = std::min(box[1], child_box[1] + offset_y);
+            box[2] = std::max(box[2], child_box[2] + offset_x);
+            box[3] = std::max(box[3], child_box[3] + offset_y);
+        }
+    }
+
+    const int64_t *box = &boxes[(size_t)root * 4];
+    start_x = box[0];
+    start_y = box[1];
+    end_x = box[2];
+    end_y = box[3];
+    return true;
+}
+
+bool Macrocell::getBoardSize(int64_t &width, int64_t &height) {
+    width = board_width;
+    height = board_height;
+    return board_width > 0 && board_height > 0;
+}
+
+int Macrocell::getLevel() { return root_level; }
+
+int Macrocell::addLeaf(uint64_t cells) {
+    if (cells == 0) {
+        return 0;
+    }
+
+    auto search = leaf_ids.find(cells);
+    if (search != leaf_ids.end()) {
+        return search->second;
+    }
+
+    MacrocellNode node;
+    node.level = 3;
+    node.cells = cells;
+    nodes.push_back(node);
+    leaf_ids[cells] = (int)nodes.size() - 1;
+    return (int)nodes.size() - 1;
+}
+
+int Macrocell::addNode(int level, int nw, int ne, int sw, int se) {
+    if (nw == 0 && ne == 0 && sw == 0 && se == 0) {
+        return 0;
+    }
+
+    auto key = std::make_tuple(level, nw, ne, sw, se);
+    auto search = node_ids.find(key);
+    if (search != node_ids.end()) {
+        return search->second;
+    }
+
+    MacrocellNode node;
+    node.level = level;
+    node.children[0] = nw;
+    node.children[1] = ne;
+    node.children[2] = sw;
+    node.children[3] = se;
+    nodes.push_back(node);
+    node_ids[key] = (int)nodes.size() - 1;
+    return (int)nodes.size() - 1;
+}
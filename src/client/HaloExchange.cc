@@ -0,0 +1,84 @@
+#include "client/HaloExchange.h"
+#include "misc/Log.h"
+#include <algorithm>
+
+HaloExchange::HaloExchange(IPNetwork *peer_net, int width) : peer_net(peer_net), width(width) {
+    for (int parity = 0; parity < 2; parity++) {
+        for (int side = 0; side < 2; side++) {
+            slots[parity][side].timestep = parity;
+            slots[parity][side].row = new LocalBoard(width, 1);
+            slots[parity][side].fragments.resize(width, false);
+        }
+    }
+}
+
+HaloExchange::~HaloExchange() {
+    // the thread must not touch the slots anymore
+    cancel();
+    for (int parity = 0; parity < 2; parity++) {
+        for (int side = 0; side < 2; side++) {
+            delete slots[parity][side].row;
+        }
+    }
+}
+
+void HaloExchange::run() {
+    IPAddress client_address = IPAddress();
+    char buffer[MAX_MESSAGE_SIZE];
+    alignas(8) char reply_buffer[MAX_MESSAGE_SIZE];
+    while (true) {
+        ssize_t received_bytes = peer_net->receive(client_address, buffer, sizeof(buffer));
+        Message *message = (Message *)buffer;
+        if (received_bytes <= 0 || message->getType() != message_type_t::halo) {
+            continue;
+        }
+
+        bool confirmed = store((HaloMessage *)buffer);
+        if (!confirmed) {
+            LOG(WARN) << "Received halo message which does not fit the area";
+        }
+        HaloMessage *rep = HaloMessage::createReply(reply_buffer, message->getSequenceNumber(), confirmed);
+        peer_net->reply(client_address, rep, rep->getSize());
+    }
+}
+
+bool HaloExchange::store(HaloMessage *message) {
+    if (!message->isValidRegion() || message->timestep < 0 || message->start_x < 0 || message->end_x > width) {
+        return false;
+    }
+
+    {
+        // the first row of a neighbour is below the area, its last row above
+        std::lock_guard<std::mutex> lock(mutex);
+        Slot &slot = slots[message->timestep % 2][message->upper_border ? 1 : 0];
+
+        // repeated messages of a cycle which was already used are answered, but not stored
+        if (slot.timestep == message->timestep && !slot.fragments[message->start_x]) {
+            if (!CellEncoding::decode(slot.row, message->start_x, 0, message->end_x - message->start_x, 1,
+                                      message->data, message->payload_size)) {
+                return false;
+            }
+            slot.fragments[message->start_x] = true;
+            slot.received_cells += message->end_x - message->start_x;
+        }
+    }
+    return true;
+}
+
+bool HaloExchange::take(int timestep, bool lower, LocalBoard *board) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Slot &slot = slots[timestep % 2][lower ? 1 : 0];
+    bool complete = slot.received_cells >= width;
+    if (complete) {
+        int y = lower ? board->getHeight() - 1 : 0;
+        for (int x = 0; x < width; x++) {
+            board->setPos(x + 1, y, slot.row->getPos(x, 0));
+        }
+    }
+
+    // prepare the slot for the next cycle with the same parity, late parts of this cycle are ignored
+    slot.timestep = timestep + 2;
+    std::fill(slot.fragments.begin(), slot.fragments.end(), false);
+    slot.received_cells = 0;
+    return complete;
+}
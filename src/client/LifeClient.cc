@@ -3,14 +3,24 @@
 LifeClient::LifeClient(IPNetwork *net, const char *servername, short port)
     : net(net), server(IPAddress(servername, port)) {}
 
-LifeClient::~LifeClient() {}
+LifeClient::~LifeClient() {
+    if (halo_exchange != nullptr) {
+        delete halo_exchange;
+    }
+    if (board != nullptr) {
+        delete board;
+    }
+    if (uploaded != nullptr) {
+        delete uploaded;
+    }
+}
 
 int LifeClient::start() {
-    char buffer[100];
+    char buffer[MAX_MESSAGE_SIZE];
     LOG(INFO) << "Loggin into server...";
-    LogonMessage *request = LogonMessage::createRequest(getNextSequenceNumber());
+    short peer_port = peer_net != nullptr ? peer_net->getPort() : 0;
+    LogonMessage *request = LogonMessage::createRequest(request_buffer, getNextSequenceNumber(), peer_port);
     ssize_t received_bytes = net->request(server, request, sizeof(LogonMessage), buffer, sizeof(buffer));
-    delete request;
     LogonMessage *result = (LogonMessage *)buffer;
     client_id = result->client_id;
     timesteps = result->timesteps;
@@ -18,9 +28,46 @@ int LifeClient::start() {
     y1 = result->start_y;
     x2 = result->end_x;
     y2 = result->end_y;
+    board_width = result->board_width;
+    board_height = result->board_height;
+    full_sync = result->full_sync;
+    rebalance_interval = result->rebalance_interval;
+    upper_peer = result->upper_peer;
+    lower_peer = result->lower_peer;
+    if (received_bytes <= 0) {
+        return -1;
+    }
     LOG(INFO) << "[CLIENT-" << client_id << "] "
               << "Login completed";
-    return received_bytes > 0 ? 0 : -1;
+
+    // without the group, the client gets its own reply at every barrier
+    if (result->group.getPort() != 0 && net->joinGroup(result->group)) {
+        LOG(INFO) << "[CLIENT-" << client_id << "] "
+                  << "Joined the multicast group for barrier releases";
+        group_member = true;
+    }
+
+    // the server lets all clients use their neighbours or none of them
+    if (result->peer_halos && peer_net != nullptr) {
+        LOG(INFO) << "[CLIENT-" << client_id << "] "
+                  << "Exchanging surroundings with clients " << result->upper_peer_id << " and "
+                  << result->lower_peer_id;
+        halo_exchange = new HaloExchange(peer_net, board_width);
+        halo_exchange->create();
+    }
+
+    // local position 0,0 is remote position x1 - 1, y1 - 1
+    board = new LocalBoard((x2 - x1) + 2, (y2 - y1) + 2);
+    if (input_path.length() > 0) {
+        if (!board->importWindow(input_path, x1 - 1, y1 - 1)) {
+            LOG(ERROR) << "Could not load area from file '" << input_path << "'";
+            return -1;
+        }
+    } else if (!getRemoteRegion(board, x1 - 1, y1 - 1, x1 - 1, y1 - 1, x2 + 1, y2 + 1)) {
+        return -1;
+    }
+    rememberArea();
+    return 0;
 };
 
 void LifeClient::loop() {
@@ -30,51 +77,314 @@ void LifeClient::loop() {
         makeStep();
         LOG(INFO) << "[CLIENT-" << client_id << "] "
                   << "Signaling doneness to server";
-        char buffer[100];
-        BarrierMessage *request = BarrierMessage::createRequest(getNextSequenceNumber(), client_id, timestep);
-        net->request(server, request, sizeof(BarrierMessage), buffer, sizeof(buffer));
+        char buffer[MAX_MESSAGE_SIZE];
+        BarrierMessage *request = BarrierMessage::createRequest(request_buffer, getNextSequenceNumber(), client_id,
+                                                                timestep, step_time, group_member);
+        // the release of all clients answers the request, it is numbered by the completed cycle
+        net->wait(net->submitGroup(server, request, sizeof(BarrierMessage), buffer, sizeof(buffer), timestep));
+        BarrierMessage *result = (BarrierMessage *)buffer;
         timestep++;
+
+        if (timestep >= timesteps) {
+            break;
+        }
+        bool moved = result->start_x != x1 || result->start_y != y1 || result->end_x != x2 || result->end_y != y2;
+        if (result->end_y > result->start_y && moved) {
+            moveArea(result->start_x, result->start_y, result->end_x, result->end_y);
+        } else {
+            requestSurroundings();
+        }
     }
 };
 
 void LifeClient::makeStep() {
-    int width = (x2 - x1) + 2;
-    int height = (y2 - y1) + 2;
-    LocalBoard *board = new LocalBoard(width, height);
-    board->clear();
-    // read remote board
-    for (int x = 0; x < board->getWidth(); x++) {
-        for (int y = 0; y < board->getHeight(); y++) {
-            board->setPos(x, y, getRemotePos(x + x1 - 1, y + y1 - 1));
+    // calculate the cells, which do not depend on the surroundings, while those are still being received
+    int width = board->getWidth();
+    int height = board->getHeight();
+    bool whole_rows = x2 - x1 == board_width;
+    auto step_start = std::chrono::steady_clock::now();
+    if (whole_rows) {
+        wrapColumns(1, height - 1);
+        board->stepRegion(1, 2, width - 1, height - 2);
+    } else {
+        board->stepRegion(2, 2, width - 2, height - 2);
+    }
+    step_time =
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - step_start).count();
+
+    if (surroundings_pending) {
+        receiveSurroundings();
+    }
+
+    // then the border of the area
+    step_start = std::chrono::steady_clock::now();
+    if (whole_rows) {
+        board->stepRegion(1, 1, width - 1, 2);
+        board->stepRegion(1, std::max(height - 2, 2), width - 1, height - 1);
+    } else {
+        board->stepFrame(1, 1, width - 1, height - 1);
+    }
+    board->completeStep();
+    step_time +=
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - step_start).count();
+
+    // write remote board, neighbours only depend on the border of the area,
+    // unless the server may move the borders of the areas after this cycle
+    bool last_step = timestep == timesteps - 1;
+    bool rebalance_step = rebalance_interval > 0 && (timestep + 1) % rebalance_interval == 0;
+    // Only the changes are sent, if the server got the same cells in the last cycle
+    bool whole_area = full_sync || last_step || rebalance_step;
+    if (whole_area) {
+        uploadRegion(x1, y1, x2, y2, area_uploaded);
+    } else if (halo_exchange == nullptr) {
+        uploadRegion(x1, y1, x2, y1 + 1, true);
+        if (y2 - 1 > y1) {
+            uploadRegion(x1, y2 - 1, x2, y2, true);
+        }
+        if (x2 - x1 < board_width) {
+            uploadRegion(x1, y1 + 1, x1 + 1, y2 - 1, true);
+            uploadRegion(x2 - 1, y1 + 1, x2, y2 - 1, true);
         }
     }
-    // do calculation
-    board->step();
-    // write remote board
-    for (int x = 1; x < board->getWidth() - 1; x++) {
-        for (int y = 1; y < board->getHeight() - 1; y++) {
-            setRemotePos(x + x1 - 1, y + y1 - 1, board->getPos(x, y));
+    area_uploaded = whole_area;
+
+    // or hand the border directly to the neighbours
+    if (halo_exchange != nullptr && !last_step) {
+        sendHalo(upper_peer, y1, true);
+        sendHalo(lower_peer, y2 - 1, false);
+    }
+};
+
+void LifeClient::requestSurroundings() {
+    // the rows of the neighbours arrive by themselves
+    surroundings_pending = true;
+    if (halo_exchange != nullptr) {
+        return;
+    }
+
+    fragments.clear();
+    if (x2 - x1 < board_width) {
+        splitRegion(x1 - 1, y1 - 1, x2 + 1, y1);
+        splitRegion(x1 - 1, y2, x2 + 1, y2 + 1);
+        splitRegion(x1 - 1, y1, x1, y2);
+        splitRegion(x2, y1, x2 + 1, y2);
+    } else {
+        splitRegion(x1, y1 - 1, x2, y1);
+        splitRegion(x1, y2, x2, y2 + 1);
+    }
+    submitGetRequests();
+};
+
+void LifeClient::receiveSurroundings() {
+    surroundings_pending = false;
+    if (halo_exchange != nullptr) {
+        // a row, which the neighbour could not hand over, was written to the server
+        bool upper_received = halo_exchange->take(timestep - 1, false, board);
+        bool lower_received = halo_exchange->take(timestep - 1, true, board);
+        if (!upper_received || !lower_received) {
+            fragments.clear();
+            if (!upper_received) {
+                splitRegion(x1, y1 - 1, x2, y1);
+            }
+            if (!lower_received) {
+                splitRegion(x1, y2, x2, y2 + 1);
+            }
+            submitGetRequests();
+            receiveGetReplies(board, x1 - 1, y1 - 1);
         }
+    } else {
+        receiveGetReplies(board, x1 - 1, y1 - 1);
+    }
+
+    // the area spans whole rows, so only the rows above and below come from other clients,
+    // the columns left and right of the area wrap around to the area itself
+    if (x2 - x1 == board_width) {
+        wrapColumns(0, 1);
+        wrapColumns(board->getHeight() - 1, board->getHeight());
+    }
+};
+
+void LifeClient::wrapColumns(int start_y, int end_y) {
+    int width = x2 - x1;
+    for (int y = start_y; y < end_y; y++) {
+        board->setPos(0, y, board->getPos(width, y));
+        board->setPos(width + 1, y, board->getPos(1, y));
+    }
+}
+
+void LifeClient::moveArea(int start_x, int start_y, int end_x, int end_y) {
+    // the rows of the neighbours were sent for the old area, their slots have to be freed nevertheless
+    if (halo_exchange != nullptr) {
+        halo_exchange->take(timestep - 1, false, board);
+        halo_exchange->take(timestep - 1, true, board);
     }
+
+    LOG(INFO) << "[CLIENT-" << client_id << "] "
+              << "Moving area to rows " << start_y << " to " << end_y;
+    x1 = start_x;
+    y1 = start_y;
+    x2 = end_x;
+    y2 = end_y;
     delete board;
+    board = new LocalBoard((x2 - x1) + 2, (y2 - y1) + 2);
+    surroundings_pending = false;
+    getRemoteRegion(board, x1 - 1, y1 - 1, x1 - 1, y1 - 1, x2 + 1, y2 + 1);
+    rememberArea();
+};
+
+void LifeClient::uploadRegion(int start_x, int start_y, int end_x, int end_y, bool changes_only) {
+    setRemoteRegion(board, x1 - 1, y1 - 1, start_x, start_y, end_x, end_y, changes_only ? uploaded : nullptr);
+    uploaded->copyRegion(board, start_x - (x1 - 1), start_y - (y1 - 1), end_x - (x1 - 1), end_y - (y1 - 1));
+}
+
+void LifeClient::rememberArea() {
+    if (uploaded != nullptr) {
+        delete uploaded;
+    }
+    uploaded = new LocalBoard(board->getWidth(), board->getHeight());
+    uploaded->copyRegion(board, 0, 0, board->getWidth(), board->getHeight());
+    area_uploaded = true;
+}
+
+void LifeClient::sendHalo(const IPAddress &peer, int row, bool upper_border) {
+    fragments.clear();
+    splitRegion(x1, row, x2, row + 1);
+
+    // a row has only a few parts, all of them are sent before waiting for the answers
+    reserveBuffers(fragments.size());
+    for (size_t i = 0; i < fragments.size(); i++) {
+        Fragment &fragment = fragments[i];
+        HaloMessage *request = HaloMessage::createRequest(request_buffer, getNextSequenceNumber(), timestep, row,
+                                                          upper_border, fragment.start_x, fragment.end_x, board,
+                                                          fragment.start_x - (x1 - 1), row - (y1 - 1));
+        handles[i] = net->submit(peer, request, request->getSize(), &answer_buffers[i * MAX_MESSAGE_SIZE],
+                                 MAX_MESSAGE_SIZE);
+    }
+    bool delivered = true;
+    for (size_t i = 0; i < fragments.size(); i++) {
+        HaloMessage *answer = (HaloMessage *)&answer_buffers[i * MAX_MESSAGE_SIZE];
+        if (net->waitFor(handles[i], HALO_TIMEOUT) <= 0 || !answer->confirmed) {
+            delivered = false;
+        }
+    }
+    if (!delivered) {
+        LOG(WARN) << "[CLIENT-" << client_id << "] "
+                  << "Neighbour did not take row " << row << ", writing it to the server";
+        uploadRegion(x1, row, x2, row + 1, false);
+    }
 };
 
 life_status_t LifeClient::getRemotePos(int x, int y) {
-    char buffer[100];
-    BoardGetMessage *request = BoardGetMessage::createRequest(getNextSequenceNumber(), x, y);
+    char buffer[MAX_MESSAGE_SIZE];
+    BoardGetMessage *request = BoardGetMessage::createRequest(request_buffer, getNextSequenceNumber(), x, y);
     net->request(server, request, sizeof(BoardGetMessage), buffer, sizeof(buffer));
     BoardGetMessage *result = (BoardGetMessage *)buffer;
-    delete request;
     return result->state;
 }
 
 bool LifeClient::setRemotePos(int x, int y, life_status_t status) {
-    char buffer[100];
-    BoardSetMessage *request = BoardSetMessage::createRequest(getNextSequenceNumber(), x, y, status);
+    char buffer[MAX_MESSAGE_SIZE];
+    BoardSetMessage *request =
+        BoardSetMessage::createRequest(request_buffer, getNextSequenceNumber(), x, y, status);
     net->request(server, request, sizeof(BoardSetMessage), buffer, sizeof(buffer));
     BoardSetMessage *result = (BoardSetMessage *)buffer;
-    delete request;
     return result->confirmed;
 }
 
+bool LifeClient::getRemoteRegion(LocalBoard *board, int board_x, int board_y, int start_x, int start_y, int end_x,
+                                 int end_y) {
+    fragments.clear();
+    splitRegion(start_x, start_y, end_x, end_y);
+    submitGetRequests();
+    return receiveGetReplies(board, board_x, board_y);
+}
+
+void LifeClient::submitGetRequests() {
+    reserveBuffers(REQUEST_WINDOW);
+    submitted_fragments = 0;
+    while (submitted_fragments < fragments.size() && submitted_fragments < REQUEST_WINDOW) {
+        submitGetRequest(submitted_fragments++);
+    }
+}
+
+void LifeClient::submitGetRequest(size_t index) {
+    Fragment &fragment = fragments[index];
+    char *buffer = &answer_buffers[(index % REQUEST_WINDOW) * MAX_MESSAGE_SIZE];
+    RegionGetMessage *request = RegionGetMessage::createRequest(request_buffer, getNextSequenceNumber(),
+                                                                fragment.start_x, fragment.start_y, fragment.end_x,
+                                                                fragment.end_y);
+    handles[index % REQUEST_WINDOW] = net->submit(server, request, request->getSize(), buffer, MAX_MESSAGE_SIZE);
+}
+
+bool LifeClient::receiveGetReplies(LocalBoard *board, int board_x, int board_y) {
+    // answers are decoded in the order of the requests, each one makes room for the next request
+    bool success = true;
+    for (size_t i = 0; i < fragments.size(); i++) {
+        Fragment &fragment = fragments[i];
+        char *buffer = &answer_buffers[(i % REQUEST_WINDOW) * MAX_MESSAGE_SIZE];
+        ssize_t received_bytes = net->wait(handles[i % REQUEST_WINDOW]);
+        RegionGetMessage *result = (RegionGetMessage *)buffer;
+        success = success && received_bytes > 0 &&
+                  CellEncoding::decode(board, fragment.start_x - board_x, fragment.start_y - board_y,
+                                       fragment.end_x - fragment.start_x, fragment.end_y - fragment.start_y,
+                                       result->data, result->payload_size);
+        if (submitted_fragments < fragments.size()) {
+            submitGetRequest(submitted_fragments++);
+        }
+    }
+    return success;
+}
+
+bool LifeClient::setRemoteRegion(LocalBoard *board, int board_x, int board_y, int start_x, int start_y, int end_x,
+                                 int end_y, LocalBoard *reference) {
+    fragments.clear();
+    splitRegion(start_x, start_y, end_x, end_y);
+
+    // keep up to REQUEST_WINDOW requests in flight
+    bool success = true;
+    reserveBuffers(REQUEST_WINDOW);
+    for (size_t i = 0; i < fragments.size() + REQUEST_WINDOW; i++) {
+        if (i >= REQUEST_WINDOW && i - REQUEST_WINDOW < fragments.size()) {
+            char *buffer = &answer_buffers[((i - REQUEST_WINDOW) % REQUEST_WINDOW) * MAX_MESSAGE_SIZE];
+            ssize_t received_bytes = net->wait(handles[(i - REQUEST_WINDOW) % REQUEST_WINDOW]);
+            RegionSetMessage *result = (RegionSetMessage *)buffer;
+            success = success && received_bytes > 0 && result->confirmed;
+        }
+        if (i < fragments.size()) {
+            Fragment &fragment = fragments[i];
+            char *buffer = &answer_buffers[(i % REQUEST_WINDOW) * MAX_MESSAGE_SIZE];
+            RegionSetMessage *request = RegionSetMessage::createRequest(
+                request_buffer, getNextSequenceNumber(), fragment.start_x, fragment.start_y, fragment.end_x,
+                fragment.end_y, board, fragment.start_x - board_x, fragment.start_y - board_y, reference);
+            handles[i % REQUEST_WINDOW] = net->submit(server, request, request->getSize(), buffer, MAX_MESSAGE_SIZE);
+        }
+    }
+    return success;
+}
+
+void LifeClient::splitRegion(int start_x, int start_y, int end_x, int end_y) {
+    int fragment_width, fragment_height;
+    getFragmentSize(end_x - start_x, end_y - start_y, fragment_width, fragment_height);
+
+    for (int y = start_y; y < end_y; y += fragment_height) {
+        for (int x = start_x; x < end_x; x += fragment_width) {
+            fragments.push_back({x, y, std::min(x + fragment_width, end_x), std::min(y + fragment_height, end_y)});
+        }
+    }
+}
+
+void LifeClient::reserveBuffers(size_t count) {
+    if (handles.size() < count) {
+        handles.resize(count);
+        answer_buffers.resize(count * MAX_MESSAGE_SIZE);
+    }
+}
+
+void LifeClient::getFragmentSize(int width, int height, int &fragment_width, int &fragment_height) {
+    // whole rows if possible, else parts of a single row
+    int max_cells = (int)CellEncoding::maxCells(REGION_PAYLOAD_SIZE);
+    fragment_width = std::min(width, max_cells);
+    fragment_height = std::max(1, std::min(height, max_cells / std::max(fragment_width, 1)));
+}
+
 unsigned int LifeClient::getNextSequenceNumber() { return sequence_number++; }
\ No newline at end of file
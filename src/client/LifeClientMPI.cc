@@ -1,120 +1,189 @@
 #include "client/LifeClientMPI.h"
 #include "misc/Log.h"
+#include <algorithm>
+#include <stdexcept>
 
-LifeClientMPI::LifeClientMPI(int root_rank) : root_rank(root_rank) {}
+LifeClientMPI::LifeClientMPI(int root_rank, std::string input_path) : root_rank(root_rank), input_path(input_path) {}
 
 LifeClientMPI::~LifeClientMPI() {
     if (board != nullptr) {
         delete board;
     }
+    if (sent != nullptr) {
+        delete sent;
+    }
 }
 
 void LifeClientMPI::start() {
     receive_timesteps();
-    receive_area(true);
+    receive_bounds();
+    if (input_path.length() > 0) {
+        // load area and surroundings from the shared input file
+        if (!board->importWindow(input_path, start_x - halo_depth, start_y - halo_depth)) {
+            throw std::runtime_error("Could not load area from file '" + input_path + "'");
+        }
+        remember_area(false);
+    } else {
+        receive_area();
+    }
     while (current_timestep < timesteps) {
-        board->step();
-        barrier();
+        // the inner cells of the first generation do not depend on the surroundings, which may still be on
+        // their way
+        int width = board->getWidth();
+        int height = board->getHeight();
+        int generations = std::min(halo_depth, timesteps - current_timestep);
+        auto step_start = std::chrono::steady_clock::now();
+        board->stepRegion(halo_depth + 1, halo_depth + 1, width - halo_depth - 1, height - halo_depth - 1);
+        step_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                          step_start)
+                        .count();
+        wait_surroundings();
+
+        // every generation leaves one row and column less of the surroundings valid,
+        // after halo_depth generations only the area itself is left
+        step_start = std::chrono::steady_clock::now();
+        board->stepFrame(1, 1, width - 1, height - 1, halo_depth);
+        board->completeStep();
+        for (int generation = 2; generation <= generations; generation++) {
+            board->stepRegion(generation, generation, width - generation, height - generation);
+            board->completeStep();
+        }
+        step_time += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                           step_start)
+                         .count();
         send_area();
-        barrier();
-        receive_area(false);
-        current_timestep++;
+
+        // after rebalancing the server sends the bounds again, and the whole area if they changed.
+        // The server rebalances, if a multiple of the interval lies within the generations of the exchange
+        int next_timestep = current_timestep + generations;
+        bool rebalance_step = rebalance_interval > 0 &&
+                              next_timestep / rebalance_interval != current_timestep / rebalance_interval &&
+                              next_timestep < timesteps;
+        if (rebalance_step && receive_bounds()) {
+            receive_area();
+        } else {
+            request_surroundings();
+        }
+        current_timestep = next_timestep;
         board->setCurrentStep(current_timestep);
     }
+
+    // the surroundings after the last cycle are not needed, but still sent
+    if (surroundings_request != MPI_REQUEST_NULL) {
+        MPI_Wait(&surroundings_request, MPI_STATUS_IGNORE);
+    }
 }
 
-void LifeClientMPI::receive_timesteps() { MPI_Bcast(&timesteps, 1, MPI_INT, root_rank, MPI_COMM_WORLD); }
+void LifeClientMPI::receive_timesteps() {
+    MPI_Bcast(&timesteps, 1, MPI_INT, root_rank, MPI_COMM_WORLD);
+    MPI_Bcast(&rebalance_interval, 1, MPI_INT, root_rank, MPI_COMM_WORLD);
+    MPI_Bcast(&halo_depth, 1, MPI_INT, root_rank, MPI_COMM_WORLD);
+}
 
 void LifeClientMPI::send_area() {
-    int buffer_size = 0;
-    MPI_Pack_size((board->getWidth() - 2) * (board->getHeight() - 2), MPI_CHAR, MPI_COMM_WORLD, &buffer_size);
+    int width = board->getWidth() - 2 * halo_depth;
+    int height = board->getHeight() - 2 * halo_depth;
+    int time_size = 0;
+    MPI_Pack_size(1, MPI_INT64_T, MPI_COMM_WORLD, &time_size);
+    int buffer_size = time_size + CellPacker::packSize(width, height);
 
-    char *buffer = new char[buffer_size];
-    bzero(buffer, buffer_size);
+    char *buffer = get_pack_buffer(buffer_size);
     int pack_counter = 0;
 
-    for (int x = 1; x < board->getWidth() - 1; x++) {
-        for (int y = 1; y < board->getHeight() - 1; y++) {
-            char life_state_byte = (char)board->getPos(x, y);
-            MPI_Pack(&life_state_byte, 1, MPI_CHAR, buffer, buffer_size, &pack_counter, MPI_COMM_WORLD);
-        }
-    }
+    MPI_Pack(&step_time, 1, MPI_INT64_T, buffer, buffer_size, &pack_counter, MPI_COMM_WORLD);
+    cell_packer.pack(board, halo_depth, halo_depth, width, height, buffer, buffer_size, pack_counter,
+                     area_sent ? sent : nullptr);
+    sent->copyRegion(board, halo_depth, halo_depth, halo_depth + width, halo_depth + height);
+    area_sent = true;
 
     MPI_Send(buffer, pack_counter, MPI_PACKED, root_rank, 3, MPI_COMM_WORLD);
-    delete[] buffer;
 }
 
-void LifeClientMPI::receive_area(bool first_pass) {
-    if (first_pass) {
-        // receive board area and surroundings
-
-        int buffer_size = 0;
-        MPI_Pack_size(4, MPI_INT, MPI_COMM_WORLD, &buffer_size);
-
-        char *buffer = new char[buffer_size];
-        int unpack_counter = 0;
-
-        MPI_Recv(buffer, buffer_size, MPI_PACKED, root_rank, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        MPI_Unpack(buffer, buffer_size, &unpack_counter, &start_x, 1, MPI_INT, MPI_COMM_WORLD);
-        MPI_Unpack(buffer, buffer_size, &unpack_counter, &start_y, 1, MPI_INT, MPI_COMM_WORLD);
-        MPI_Unpack(buffer, buffer_size, &unpack_counter, &end_x, 1, MPI_INT, MPI_COMM_WORLD);
-        MPI_Unpack(buffer, buffer_size, &unpack_counter, &end_y, 1, MPI_INT, MPI_COMM_WORLD);
-
-        int width = (end_x - start_x) + 2;
-        int height = (end_y - start_y) + 2;
-        board = new LocalBoard(width, height);
-        board->clear();
-
-        delete[] buffer;
-
-        buffer_size = 0;
-        MPI_Pack_size(board->getWidth() * board->getHeight(), MPI_CHAR, MPI_COMM_WORLD, &buffer_size);
-        buffer = new char[buffer_size];
-        unpack_counter = 0;
-
-        MPI_Recv(buffer, buffer_size, MPI_PACKED, root_rank, 2, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        for (int x = 0; x < board->getWidth(); x++) {
-            for (int y = 0; y < board->getHeight(); y++) {
-                char life_state_byte = 0;
-                MPI_Unpack(buffer, buffer_size, &unpack_counter, &life_state_byte, 1, MPI_CHAR, MPI_COMM_WORLD);
-                board->setPos(x, y, (life_status_t)life_state_byte);
-            }
-        }
+bool LifeClientMPI::receive_bounds() {
+    int buffer_size = 0;
+    MPI_Pack_size(4, MPI_INT, MPI_COMM_WORLD, &buffer_size);
 
-        delete[] buffer;
-    } else {
-        // receive surroundings of board area
-        int buffer_size = 0;
-        MPI_Pack_size(board->getWidth() * 2 + board->getHeight() * 2, MPI_CHAR, MPI_COMM_WORLD, &buffer_size);
+    char *buffer = get_pack_buffer(buffer_size);
+    int unpack_counter = 0;
 
-        char *buffer = new char[buffer_size];
-        bzero(buffer, buffer_size);
-        int unpack_counter = 0;
+    int new_start_x, new_start_y, new_end_x, new_end_y;
+    MPI_Recv(buffer, buffer_size, MPI_PACKED, root_rank, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Unpack(buffer, buffer_size, &unpack_counter, &new_start_x, 1, MPI_INT, MPI_COMM_WORLD);
+    MPI_Unpack(buffer, buffer_size, &unpack_counter, &new_start_y, 1, MPI_INT, MPI_COMM_WORLD);
+    MPI_Unpack(buffer, buffer_size, &unpack_counter, &new_end_x, 1, MPI_INT, MPI_COMM_WORLD);
+    MPI_Unpack(buffer, buffer_size, &unpack_counter, &new_end_y, 1, MPI_INT, MPI_COMM_WORLD);
 
-        MPI_Recv(buffer, buffer_size, MPI_PACKED, root_rank, 2, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    if (board != nullptr && new_start_x == start_x && new_start_y == start_y && new_end_x == end_x &&
+        new_end_y == end_y) {
+        return false;
+    }
 
-        for (int x = 0; x < board->getWidth(); x++) {
-            char life_state_byte = 0;
-            MPI_Unpack(buffer, buffer_size, &unpack_counter, &life_state_byte, 1, MPI_CHAR, MPI_COMM_WORLD);
-            board->setPos(x, 0, (life_status_t)life_state_byte);
+    start_x = new_start_x;
+    start_y = new_start_y;
+    end_x = new_end_x;
+    end_y = new_end_y;
+    if (board != nullptr) {
+        delete board;
+    }
+    board = new LocalBoard((end_x - start_x) + 2 * halo_depth, (end_y - start_y) + 2 * halo_depth);
+    board->setCurrentStep(current_timestep);
+    return true;
+}
 
-            life_state_byte = 0;
-            MPI_Unpack(buffer, buffer_size, &unpack_counter, &life_state_byte, 1, MPI_CHAR, MPI_COMM_WORLD);
-            board->setPos(x, board->getHeight() - 1, (life_status_t)life_state_byte);
-        }
+void LifeClientMPI::receive_area() {
+    // receive board area and surroundings
+    int buffer_size = CellPacker::packSize(board->getWidth(), board->getHeight());
+    char *buffer = get_pack_buffer(buffer_size);
+    int unpack_counter = 0;
 
-        for (int y = 0; y < board->getHeight(); y++) {
-            char life_state_byte = 0;
-            MPI_Unpack(buffer, buffer_size, &unpack_counter, &life_state_byte, 1, MPI_CHAR, MPI_COMM_WORLD);
-            board->setPos(0, y, (life_status_t)life_state_byte);
+    MPI_Recv(buffer, buffer_size, MPI_PACKED, root_rank, 2, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    cell_packer.unpack(board, 0, 0, board->getWidth(), board->getHeight(), buffer, buffer_size, unpack_counter);
+    remember_area(true);
+}
 
-            life_state_byte = 0;
-            MPI_Unpack(buffer, buffer_size, &unpack_counter, &life_state_byte, 1, MPI_CHAR, MPI_COMM_WORLD);
-            board->setPos(board->getWidth() - 1, y, (life_status_t)life_state_byte);
-        }
+void LifeClientMPI::remember_area(bool known_to_server) {
+    if (sent != nullptr) {
+        delete sent;
+    }
+    sent = new LocalBoard(board->getWidth(), board->getHeight());
+    sent->copyRegion(board, 0, 0, board->getWidth(), board->getHeight());
+    area_sent = known_to_server;
+}
 
-        delete[] buffer;
+void LifeClientMPI::request_surroundings() {
+    // halo_depth rows above and below the area, and as many columns left and right of it
+    int height = board->getHeight() - 2 * halo_depth;
+    int buffer_size =
+        2 * CellPacker::packSize(board->getWidth(), halo_depth) + 2 * CellPacker::packSize(halo_depth, height);
+    if (surroundings_buffer.size() < (size_t)buffer_size) {
+        surroundings_buffer.resize(buffer_size);
     }
+    MPI_Irecv(surroundings_buffer.data(), buffer_size, MPI_PACKED, root_rank, 2, MPI_COMM_WORLD,
+              &surroundings_request);
 }
 
-void LifeClientMPI::barrier() { MPI_Barrier(MPI_COMM_WORLD); }
\ No newline at end of file
+void LifeClientMPI::wait_surroundings() {
+    if (surroundings_request == MPI_REQUEST_NULL) {
+        return;
+    }
+    MPI_Wait(&surroundings_request, MPI_STATUS_IGNORE);
+
+    char *buffer = surroundings_buffer.data();
+    int buffer_size = (int)surroundings_buffer.size();
+    int unpack_counter = 0;
+    int width = board->getWidth();
+    int height = board->getHeight();
+    cell_packer.unpack(board, 0, 0, width, halo_depth, buffer, buffer_size, unpack_counter);
+    cell_packer.unpack(board, 0, height - halo_depth, width, halo_depth, buffer, buffer_size, unpack_counter);
+    cell_packer.unpack(board, 0, halo_depth, halo_depth, height - 2 * halo_depth, buffer, buffer_size,
+                       unpack_counter);
+    cell_packer.unpack(board, width - halo_depth, halo_depth, halo_depth, height - 2 * halo_depth, buffer,
+                       buffer_size, unpack_counter);
+}
+
+char *LifeClientMPI::get_pack_buffer(int buffer_size) {
+    if (pack_buffer.size() < (size_t)buffer_size) {
+        pack_buffer.resize(buffer_size);
+    }
+    return pack_buffer.data();
+}
\ No newline at end of file
@@ -2,8 +2,10 @@
 #include "client/LifeClient.h"
 #include "net/IPAddress.h"
 #include "net/IPNetwork.h"
+#include "net/SHMNetwork.h"
 #include "net/TCPNetwork.h"
 #include "net/UDPNetwork.h"
+#include "net/UnixNetwork.h"
 #include <boost/program_options.hpp>
 
 #include "misc/Log.h"
@@ -24,11 +26,14 @@ int main(int argc, char **argv) {
 
     // define available arguments
     po::options_description desc("Usage", 1024, 512);
-    desc.add_options()                                                                                //
-        ("help,", "Print help message")                                                               //
-        ("host,", po::value<std::string>()->default_value("localhost"), "Server address")             //
-        ("port,", po::value<short>()->default_value(7654), "Server port")                             //
-        ("network,n", po::value<int>()->default_value(0), "IP Network type\nTypes:\n0) UDP\n1) TCP"); //
+    desc.add_options()                                                                              //
+        ("help,", "Print help message")                                                             //
+        ("host,", po::value<std::string>()->default_value("localhost"), "Server address")           //
+        ("port,", po::value<short>()->default_value(7654), "Server port")                           //
+        ("network,n", po::value<int>()->default_value(0),                                           //
+         "IP Network type\nTypes:\n0) UDP\n1) TCP\n2) SHM\n3) Unix datagram\n4) Unix stream")       //
+        ("input,i", po::value<std::string>(), "Load the initial area from the server's input file") //
+        ("peer,p", "Exchange surrounding rows directly with the neighbouring clients");             //
 
     // read arguments
     po::variables_map vm;
@@ -52,19 +57,45 @@ int main(int argc, char **argv) {
     std::string server_name = vm["host"].as<std::string>();
     short server_port = vm["port"].as<short>();
 
+    // the peer network is bound to a port chosen by the system
     IPNetwork *net;
+    IPNetwork *peer_net = nullptr;
+    bool use_peers = vm.count("peer") > 0;
     int network_type = vm["network"].as<int>();
     switch (network_type) {
     case 0: {
         net = (IPNetwork *)new UDPNetwork();
+        if (use_peers) {
+            peer_net = (IPNetwork *)new UDPNetwork(0);
+        }
         LOG(DEBUG) << "Using UDP";
         break;
     }
     case 1: {
         net = (IPNetwork *)new TCPNetwork();
+        if (use_peers) {
+            peer_net = (IPNetwork *)new TCPNetwork(0, 2);
+        }
         LOG(DEBUG) << "Using TCP";
         break;
     }
+    case 2: {
+        net = (IPNetwork *)new SHMNetwork();
+        if (use_peers) {
+            peer_net = (IPNetwork *)new SHMNetwork(0);
+        }
+        LOG(DEBUG) << "Using shared memory";
+        break;
+    }
+    case 3:
+    case 4: {
+        net = (IPNetwork *)new UnixNetwork(network_type == 4);
+        if (use_peers) {
+            peer_net = (IPNetwork *)new UnixNetwork(0, network_type == 4);
+        }
+        LOG(DEBUG) << "Using unix domain sockets";
+        break;
+    }
     default: {
         LOG(ERROR) << network_type << " is not a valid network type";
         return 1;
@@ -72,6 +103,12 @@ int main(int argc, char **argv) {
     }
 
     LifeClient *life_client = new LifeClient(net, server_name.c_str(), server_port);
+    if (vm.count("input")) {
+        life_client->setInput(vm["input"].as<std::string>());
+    }
+    if (peer_net != nullptr) {
+        life_client->setPeerNetwork(peer_net);
+    }
     int status = life_client->start();
     if (status != 0) {
         LOG(ERROR) << "Could not start GoL LifeClient";
@@ -80,5 +117,9 @@ int main(int argc, char **argv) {
     }
 
     delete life_client;
+    if (peer_net != nullptr) {
+        delete peer_net;
+    }
+    delete net;
     return 0;
 }
@@ -22,14 +22,17 @@ int main(int argc, char **argv) {
 
     // define available arguments
     po::options_description desc("Usage", 1024, 512);
-    desc.add_options()                                                                                    //
-        ("help,", "Print help message")                                                                   //
-        ("input,i", po::value<string>(), "Input file\nMust be in the correct .rle format")                //
-        ("output,o", po::value<string>(), "Output file\nExisting files will be overwriten")               //
-        ("steps,r", po::value<int>()->default_value(1), "Simulation steps")                               //
-        ("width,w", po::value<int>()->default_value(100), "Width of the board\nNot compatible with -i")   //
-        ("height,h", po::value<int>()->default_value(100), "Height of the board\nNot compatible with -i") //
-        ("profile,", po::value<string>(), "Output file for profiler");                                    //
+    desc.add_options()                                                                                          //
+        ("help,", "Print help message")                                                                         //
+        ("input,i", po::value<string>(), "Input file\nMust be in the correct .rle format")                      //
+        ("output,o", po::value<string>(), "Output file\nExisting files will be overwriten")                     //
+        ("steps,r", po::value<int>()->default_value(1), "Simulation steps")                                     //
+        ("width,w", po::value<int>()->default_value(100), "Width of the board\nNot compatible with -i")         //
+        ("height,h", po::value<int>()->default_value(100), "Height of the board\nNot compatible with -i")       //
+        ("rebalance,b", po::value<int>()->default_value(0), "Cycles between balancing the load\n0 disables it") //
+        ("depth,d", po::value<int>()->default_value(1), "Generations between exchanges\nRows around each area") //
+        ("profile,", po::value<string>(), "Output file for profiler")                                           //
+        ("index,", "Clients load their areas from -i\nCreates a row index");                                    //
 
     // read arguments and store in a map
     po::variables_map vm;
@@ -64,6 +67,9 @@ int main(int argc, char **argv) {
     if (vm.count("profile")) {
         profiler_output = vm["profile"].as<std::string>();
     }
+    bool use_index = vm.count("index") > 0;
+    int rebalance_interval = vm["rebalance"].as<int>();
+    int halo_depth = vm["depth"].as<int>();
 
     // validate arguments
     if (simulation_steps <= 0) {
@@ -78,6 +84,18 @@ int main(int argc, char **argv) {
         LOG(ERROR) << "'height' must be greater than 0, was '" << board_height << "'";
         return 1;
     }
+    if (rebalance_interval < 0) {
+        LOG(ERROR) << "'rebalance' must not be negative, was '" << rebalance_interval << "'";
+        return 1;
+    }
+    if (halo_depth <= 0) {
+        LOG(ERROR) << "'depth' must be greater than 0, was '" << halo_depth << "'";
+        return 1;
+    }
+    if (use_index && input_path == "RANDOM") {
+        LOG(ERROR) << "'index' requires an input file";
+        return 1;
+    }
 
     MPI_Init(&argc, &argv);
 
@@ -97,15 +115,30 @@ int main(int argc, char **argv) {
 
         if (my_rank == server_rank) {
             // is server
-            LocalBoard *board_read = new LocalBoard(board_width, board_height);
-            board_read->importAll(input_path);
+            LocalBoard *board_read = nullptr;
+            if (use_index) {
+                // the clients load their areas themselves, the server only needs the board size
+                if (!LocalBoard::hasIndex(input_path) && !LocalBoard::buildIndex(input_path)) {
+                    throw std::runtime_error("Could not create row index for '" + input_path + "'");
+                }
+                if (!LocalBoard::readSize(input_path, board_width, board_height)) {
+                    throw std::runtime_error("Could not read board size from '" + input_path + "'");
+                }
+                board_read = new LocalBoard(board_width, board_height);
+            } else {
+                board_read = new LocalBoard(board_width, board_height);
+                board_read->importAll(input_path);
+            }
 
-            LocalBoard *board_write = new LocalBoard(board_width, board_height);
+            LocalBoard *board_write = new LocalBoard(board_read->getWidth(), board_read->getHeight());
             board_write->clear();
 
             Stopwatch stopwatch;
 
             BoardServerMPI server = BoardServerMPI(board_read, board_write, simulation_steps);
+            server.set_clients_load_input(use_index);
+            server.set_rebalance_interval(rebalance_interval);
+            server.set_halo_depth(halo_depth);
             server.start(&stopwatch);
 
             if (output_path.length() > 0) {
@@ -120,7 +153,7 @@ int main(int argc, char **argv) {
             delete board_write;
         } else {
             // is client
-            LifeClientMPI client = LifeClientMPI(server_rank);
+            LifeClientMPI client = LifeClientMPI(server_rank, use_index ? input_path : "");
             client.start();
         }
     } catch (const std::exception &e) {
@@ -4,13 +4,17 @@
 #include "gui/BoardDrawingWindow.h"
 #include "net/IPAddress.h"
 #include "net/IPNetwork.h"
+#include "net/SHMNetwork.h"
 #include "net/TCPNetwork.h"
 #include "net/UDPNetwork.h"
+#include "net/UnixNetwork.h"
 #include <boost/program_options.hpp>
 
 using namespace std;
 using namespace GUI;
 
+static const short SERVER_PORT = 7654; // port of the server in every network type
+
 int write_benchmark_file(string file_path, long time) {
     ofstream benchmark_file(file_path);
     benchmark_file << time;
@@ -34,17 +38,22 @@ int main(int argc, char **argv) {
 
     // define available arguments
     po::options_description desc("Usage", 1024, 512);
-    desc.add_options()                                                                                         //
-        ("help,", "Print help message")                                                                        //
-        ("input,i", po::value<string>()->default_value(""), "Input file\nMust be in the correct .rle format")  //
-        ("output,o", po::value<string>()->default_value(""), "Output file\nExisting files will be overwriten") //
-        ("steps,r", po::value<int>()->default_value(1), "Simulation steps")                                    //
-        ("width,w", po::value<int>()->default_value(100), "Width of the board\nNot compatible with -i")        //
-        ("height,h", po::value<int>()->default_value(100), "Height of the board\nNot compatible with -i")      //
-        ("clients,c", po::value<int>()->default_value(1), "Required connected clients")                        //
-        ("network,n", po::value<int>()->default_value(0), "IP Network type\nTypes:\n  0) UDP\n  1) TCP")       //
-        ("profile,", po::value<string>(), "Output file for profiler\nNot compatible with -g")                  //
-        ("gui,g", "Enable GUI");                                                                               //
+    desc.add_options()                                                                                          //
+        ("help,", "Print help message")                                                                         //
+        ("input,i", po::value<string>()->default_value(""), "Input file\nMust be in the correct .rle format")   //
+        ("output,o", po::value<string>()->default_value(""), "Output file\nExisting files will be overwriten")  //
+        ("steps,r", po::value<int>()->default_value(1), "Simulation steps")                                     //
+        ("width,w", po::value<int>()->default_value(100), "Width of the board\nNot compatible with -i")         //
+        ("height,h", po::value<int>()->default_value(100), "Height of the board\nNot compatible with -i")       //
+        ("clients,c", po::value<int>()->default_value(1), "Required connected clients")                         //
+        ("network,n", po::value<int>()->default_value(0),                                                       //
+         "IP Network type\nTypes:\n  0) UDP\n  1) TCP\n  2) SHM\n  3) Unix datagram\n  4) Unix stream")         //
+        ("threads,t", po::value<int>()->default_value(1), "Threads serving requests\nOne socket each")          //
+        ("rebalance,b", po::value<int>()->default_value(0), "Cycles between balancing the load\n0 disables it") //
+        ("multicast,m", po::value<string>(),                                                                    //
+         "Multicast group releasing the clients\nUDP only, address[:port]\nPort defaults to server port + 1")   //
+        ("profile,", po::value<string>(), "Output file for profiler\nNot compatible with -g")                   //
+        ("gui,g", "Enable GUI");                                                                                //
 
     // read arguments
     po::variables_map vm;
@@ -90,23 +99,49 @@ int main(int argc, char **argv) {
         return 1;
     }
 
-    IPNetwork *net;
-    int network_type = vm["network"].as<int>();
-    switch (network_type) {
-    case 0: {
-        net = (IPNetwork *)new UDPNetwork(7654);
-        LOG(DEBUG) << "Using UDP";
-        break;
-    }
-    case 1: {
-        net = (IPNetwork *)new TCPNetwork(7654, client_count);
-        LOG(DEBUG) << "Using TCP";
-        break;
-    }
-    default: {
-        LOG(ERROR) << "'network' must be a valid network type";
+    int thread_count = vm["threads"].as<int>();
+    if (thread_count <= 0) {
+        LOG(ERROR) << "'threads' argument must be greater than 0";
         return 1;
     }
+
+    int rebalance_interval = vm["rebalance"].as<int>();
+    if (rebalance_interval < 0) {
+        LOG(ERROR) << "'rebalance' argument must not be negative";
+        return 1;
+    }
+
+    // all sockets share the server port
+    std::vector<IPNetwork *> nets;
+    int network_type = vm["network"].as<int>();
+    for (int i = 0; i < thread_count; i++) {
+        switch (network_type) {
+        case 0: {
+            nets.push_back((IPNetwork *)new UDPNetwork(SERVER_PORT));
+            LOG(DEBUG) << "Using UDP";
+            break;
+        }
+        case 1: {
+            nets.push_back((IPNetwork *)new TCPNetwork(SERVER_PORT, client_count));
+            LOG(DEBUG) << "Using TCP";
+            break;
+        }
+        case 2: {
+            nets.push_back((IPNetwork *)new SHMNetwork(SERVER_PORT));
+            LOG(DEBUG) << "Using shared memory";
+            break;
+        }
+        case 3:
+        case 4: {
+            nets.push_back((IPNetwork *)new UnixNetwork(SERVER_PORT, network_type == 4));
+            LOG(DEBUG) << "Using unix domain sockets";
+            break;
+        }
+        default: {
+            LOG(ERROR) << "'network' must be a valid network type";
+            return 1;
+        }
+        }
     }
 
     string input_path = "RANDOM";
@@ -136,7 +171,29 @@ int main(int argc, char **argv) {
         window_write = new BoardDrawingWindow(board_write, 800, 800);
     }
 
-    BoardServer *board_server = new BoardServer(net, client_count, board_read, board_write, simulation_steps);
+    BoardServer *board_server = new BoardServer(nets, client_count, board_read, board_write, simulation_steps);
+    board_server->setFullSync(vm.count("gui") > 0);
+    board_server->setRebalanceInterval(rebalance_interval);
+    if (vm.count("multicast")) {
+        // the port may follow the address, the clients learn the whole group from the logon reply
+        string group_host = vm["multicast"].as<string>();
+        int group_port = SERVER_PORT + 1;
+        size_t separator = group_host.find(':');
+        if (separator != string::npos) {
+            group_port = atoi(group_host.c_str() + separator + 1);
+            group_host.resize(separator);
+        }
+        if (group_port <= 0 || group_port > 65535) {
+            LOG(ERROR) << "'multicast' port must be between 1 and 65535";
+            return 1;
+        }
+        IPAddress group(group_host.c_str(), (short)group_port);
+        if (!IN_MULTICAST(group.getAddr())) {
+            LOG(ERROR) << "'multicast' argument must be a multicast address";
+            return 1;
+        }
+        board_server->setMulticastGroup(group);
+    }
     board_server->start();
 
     if (vm.count("profile")) {
@@ -157,6 +214,8 @@ int main(int argc, char **argv) {
     }
 
     delete board_server;
-    delete net;
+    for (IPNetwork *net : nets) {
+        delete net;
+    }
     return 0;
 }
@@ -1,4 +1,5 @@
 #include "board/Board.h"
+#include "board/LoadBalancer.h"
 #include "board/LocalBoard.h"
 #include "client/TACOClient.h"
 #include "misc/Stopwatch.h"
@@ -17,23 +18,10 @@ struct client_area {
 
 void taco_calculate_area(int client_id, int client_count, int board_width, int board_height, int &start_x, int &start_y,
                          int &end_x, int &end_y) {
-    // rows are evenly distributed among clients.
-    // If it can not be evenly distributed, early clients get a row more than later clients.
-    // Example: 100 rows, 7 clients, 0 = 15, 1 = 15, 2 to 6 = 14
+    // the board is split into a grid of blocks with evenly distributed rows and columns, see LoadBalancer.
+    // Example: 100 x 100 cells, 4 clients, 2 x 2 blocks of 50 x 50 cells
 
-    int clients = client_count;
-    int rows = board_height;
-
-    int rows_per_client = rows / clients;
-    int rows_per_client_remainder = rows % clients;
-
-    int already_used_rows = client_id * rows_per_client + min(client_id, rows_per_client_remainder);
-    int rows_used_by_this_client = rows_per_client + (client_id < rows_per_client_remainder ? 1 : 0);
-
-    start_x = 0;
-    start_y = already_used_rows;
-    end_x = board_width;
-    end_y = start_y + rows_used_by_this_client;
+    LoadBalancer(board_width, board_height, client_count).getArea(client_id, start_x, start_y, end_x, end_y);
 }
 
 int parse_command_line_args(int argc, char **argv, po::variables_map &vm) {
@@ -143,9 +131,15 @@ int main(int argc, char **argv) {
         return 0;
     }
 
+    // every client needs at least a cell, rows always work
+    int grid_rows, grid_columns;
+    if (!LoadBalancer::chooseGrid(board_width, board_height, client_count, grid_rows, grid_columns)) {
+        client_count = min(client_count, board_height);
+    }
+
     // calculate the client areas
     vector<client_area> client_areas;
-    for (int i = 0; i < min(client_count, board_height); i++) {
+    for (int i = 0; i < client_count; i++) {
         client_area area = client_area();
         taco_calculate_area(i, client_count, board_width, board_height, area.start_x, area.start_y, area.end_x,
                             area.end_y);
@@ -157,7 +151,7 @@ int main(int argc, char **argv) {
 
     // create the clients that use the shared board
     vector<taco::ObjectPtr<TACOClient>> taco_clients;
-    for (int i = 0; i < min(client_count, board_height); i++) {
+    for (int i = 0; i < client_count; i++) {
         client_area area = client_areas[i];
         taco::ObjectPtr<TACOClient> client =
             taco::allocate<TACOClient>(i + 1)(area.start_x, area.start_y, area.end_x, area.end_y, server_board);
@@ -172,9 +166,9 @@ int main(int argc, char **argv) {
         if (step == 0)
             stopwatch.start();
         vector<taco::Future<bool> *> barrier;
-        apply_with_barrier(taco_clients, barrier, min(client_count, board_height), taco::m2f(&TACOClient::import_area));
-        apply_with_barrier(taco_clients, barrier, min(client_count, board_height), taco::m2f(&TACOClient::step));
-        apply_with_barrier(taco_clients, barrier, min(client_count, board_height), taco::m2f(&TACOClient::export_area));
+        apply_with_barrier(taco_clients, barrier, client_count, taco::m2f(&TACOClient::import_area));
+        apply_with_barrier(taco_clients, barrier, client_count, taco::m2f(&TACOClient::step));
+        apply_with_barrier(taco_clients, barrier, client_count, taco::m2f(&TACOClient::export_area));
         stopwatch.stop();
 
         _DEBUG(cout << "Step " << step << " done" << endl;)
@@ -0,0 +1,183 @@
+#include <string.h>
+
+#include "net/CellEncoding.h"
+
+size_t CellEncoding::encode(Board *board, int start_x, int start_y, int width, int height, unsigned char *data,
+                            Board *reference) {
+    if (reference != nullptr) {
+        size_t size = encodeCells(board, start_x, start_y, width, height, data, reference);
+        if (size < encodedSize((size_t)width * height)) {
+            data[0] |= DIFFERENCE;
+            return size;
+        }
+    }
+    return encodeCells(board, start_x, start_y, width, height, data, nullptr);
+}
+
+size_t CellEncoding::encodeCells(Board *board, int start_x, int start_y, int width, int height, unsigned char *data,
+                                 Board *reference) {
+    size_t cells = (size_t)width * height;
+    size_t bitmap_size = encodedSize(cells);
+
+    // measure the compressed formats first, they are only used if they are smaller
+    size_t runs_size = 1, sparse_size = 1;
+    size_t run = 0, dead_before = 0;
+    bool run_alive = false;
+    for (int y = start_y; y < start_y + height; y++) {
+        for (int x = start_x; x < start_x + width; x++) {
+            bool alive = isAlive(board, reference, x, y);
+            if (alive != run_alive) {
+                runs_size += lengthSize(run);
+                run = 0;
+                run_alive = alive;
+            }
+            run++;
+            if (alive) {
+                sparse_size += lengthSize(dead_before);
+                dead_before = 0;
+            } else {
+                dead_before++;
+            }
+        }
+    }
+    runs_size += lengthSize(run);
+
+    if (bitmap_size <= runs_size && bitmap_size <= sparse_size) {
+        data[0] = cell_format_t::bitmap;
+        bzero(data + 1, bitmap_size - 1);
+        size_t bit = 0;
+        for (int y = start_y; y < start_y + height; y++) {
+            for (int x = start_x; x < start_x + width; x++, bit++) {
+                if (isAlive(board, reference, x, y)) {
+                    data[1 + bit / 8] |= (unsigned char)(1 << (bit % 8));
+                }
+            }
+        }
+        return bitmap_size;
+    }
+
+    bool use_runs = runs_size <= sparse_size;
+    data[0] = use_runs ? cell_format_t::runs : cell_format_t::sparse;
+    size_t size = 1;
+    run = 0;
+    dead_before = 0;
+    run_alive = false;
+    for (int y = start_y; y < start_y + height; y++) {
+        for (int x = start_x; x < start_x + width; x++) {
+            bool alive = isAlive(board, reference, x, y);
+            if (use_runs && alive != run_alive) {
+                size += writeLength(run, data + size);
+                run = 0;
+                run_alive = alive;
+            }
+            run++;
+            if (!use_runs && alive) {
+                size += writeLength(dead_before, data + size);
+                dead_before = 0;
+            } else if (!alive) {
+                dead_before++;
+            }
+        }
+    }
+    if (use_runs) {
+        size += writeLength(run, data + size);
+    }
+    return size;
+}
+
+bool CellEncoding::decode(Board *board, int start_x, int start_y, int width, int height, const unsigned char *data,
+                          size_t size, Board *reference) {
+    size_t cells = (size_t)width * height;
+    if (size < 1 || ((data[0] & DIFFERENCE) != 0 && reference == nullptr)) {
+        return false;
+    }
+    if ((data[0] & DIFFERENCE) == 0) {
+        reference = nullptr;
+    }
+
+    switch (data[0] & ~DIFFERENCE) {
+    case cell_format_t::bitmap: {
+        if (size < encodedSize(cells)) {
+            return false;
+        }
+        size_t bit = 0;
+        for (int y = start_y; y < start_y + height; y++) {
+            for (int x = start_x; x < start_x + width; x++, bit++) {
+                bool alive = (data[1 + bit / 8] >> (bit % 8)) & 1;
+                setAlive(board, reference, x, y, alive);
+            }
+        }
+        return true;
+    }
+    case cell_format_t::runs: {
+        // the runs have to cover the area exactly
+        size_t position = 1, cell = 0, run = 0;
+        bool alive = true;
+        for (int y = start_y; y < start_y + height; y++) {
+            for (int x = start_x; x < start_x + width; x++, cell++) {
+                while (run == 0) {
+                    if (!readLength(data, size, position, run) || run > cells - cell) {
+                        return false;
+                    }
+                    alive = !alive;
+                }
+                setAlive(board, reference, x, y, alive);
+                run--;
+            }
+        }
+        return run == 0 && position == size;
+    }
+    case cell_format_t::sparse: {
+        size_t position = 1, dead_before = 0;
+        bool has_next = position < size;
+        if (has_next && !readLength(data, size, position, dead_before)) {
+            return false;
+        }
+        for (int y = start_y; y < start_y + height; y++) {
+            for (int x = start_x; x < start_x + width; x++) {
+                bool alive = has_next && dead_before == 0;
+                setAlive(board, reference, x, y, alive);
+                if (!alive) {
+                    dead_before--;
+                } else if ((has_next = position < size) && !readLength(data, size, position, dead_before)) {
+                    return false;
+                }
+            }
+        }
+        return !has_next;
+    }
+    default:
+        return false;
+    }
+}
+
+size_t CellEncoding::lengthSize(size_t length) {
+    size_t size = 1;
+    while (length >= 0x80) {
+        length >>= 7;
+        size++;
+    }
+    return size;
+}
+
+size_t CellEncoding::writeLength(size_t length, unsigned char *data) {
+    size_t size = 0;
+    while (length >= 0x80) {
+        data[size++] = (unsigned char)(length & 0x7f) | 0x80;
+        length >>= 7;
+    }
+    data[size++] = (unsigned char)length;
+    return size;
+}
+
+bool CellEncoding::readLength(const unsigned char *data, size_t size, size_t &position, size_t &length) {
+    length = 0;
+    for (int shift = 0; position < size && shift < 64; shift += 7) {
+        unsigned char byte = data[position++];
+        length |= (size_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
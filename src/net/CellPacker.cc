@@ -0,0 +1,43 @@
+#include <stdexcept>
+
+#include "net/CellEncoding.h"
+#include "net/CellPacker.h"
+
+int CellPacker::packSize(int width, int height) {
+    int size_size = 0, cells_size = 0;
+    MPI_Pack_size(1, MPI_INT, MPI_COMM_WORLD, &size_size);
+    MPI_Pack_size((int)CellEncoding::encodedSize((size_t)width * height), MPI_UNSIGNED_CHAR, MPI_COMM_WORLD,
+                  &cells_size);
+    return size_size + cells_size;
+}
+
+void CellPacker::pack(Board *board, int start_x, int start_y, int width, int height, char *buffer, int buffer_size,
+                      int &position, Board *reference) {
+    unsigned char *data = getCells(CellEncoding::encodedSize((size_t)width * height));
+    int size = (int)CellEncoding::encode(board, start_x, start_y, width, height, data, reference);
+    MPI_Pack(&size, 1, MPI_INT, buffer, buffer_size, &position, MPI_COMM_WORLD);
+    MPI_Pack(data, size, MPI_UNSIGNED_CHAR, buffer, buffer_size, &position, MPI_COMM_WORLD);
+}
+
+void CellPacker::unpack(Board *board, int start_x, int start_y, int width, int height, char *buffer,
+                        int buffer_size, int &position, Board *reference) {
+    size_t max_size = CellEncoding::encodedSize((size_t)width * height);
+    int size = 0;
+    MPI_Unpack(buffer, buffer_size, &position, &size, 1, MPI_INT, MPI_COMM_WORLD);
+    if (size < 0 || (size_t)size > max_size) {
+        throw std::runtime_error("Received an area with an invalid size");
+    }
+
+    unsigned char *data = getCells(max_size);
+    MPI_Unpack(buffer, buffer_size, &position, data, size, MPI_UNSIGNED_CHAR, MPI_COMM_WORLD);
+    if (!CellEncoding::decode(board, start_x, start_y, width, height, data, size, reference)) {
+        throw std::runtime_error("Received a malformed area");
+    }
+}
+
+unsigned char *CellPacker::getCells(size_t size) {
+    if (cells.size() < size) {
+        cells.resize(size);
+    }
+    return cells.data();
+}
@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "net/IOURing.h"
+
+IOURing::IOURing(unsigned entries) {
+    io_uring_params params;
+    bzero(&params, sizeof(params));
+    ring_fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring_fd < 0) {
+        ring_fd = -1;
+        return;
+    }
+    features = params.features;
+
+    // newer kernels map both rings at once
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (features & IORING_FEAT_SINGLE_MMAP) {
+        sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+    }
+    sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                   IORING_OFF_SQ_RING);
+    cq_ring = (features & IORING_FEAT_SINGLE_MMAP)
+                  ? sq_ring
+                  : mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                         IORING_OFF_CQ_RING);
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = (io_uring_sqe *)mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                                IORING_OFF_SQES);
+    if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes == MAP_FAILED) {
+        close(ring_fd);
+        ring_fd = -1;
+        return;
+    }
+
+    char *sq = (char *)sq_ring;
+    sq_entries = params.sq_entries;
+    sq_head = (unsigned *)(sq + params.sq_off.head);
+    sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    sq_array = (unsigned *)(sq + params.sq_off.array);
+    sqe_tail = *sq_tail;
+
+    char *cq = (char *)cq_ring;
+    cq_head = (unsigned *)(cq + params.cq_off.head);
+    cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    cqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+}
+
+IOURing::~IOURing() {
+    if (ring_fd == -1) {
+        return;
+    }
+    if (buffer_ring != nullptr) {
+        munmap(buffer_ring, buffer_ring_size);
+    }
+    munmap(sqes, sqes_size);
+    if (cq_ring != sq_ring) {
+        munmap(cq_ring, cq_ring_size);
+    }
+    munmap(sq_ring, sq_ring_size);
+    close(ring_fd);
+}
+
+io_uring_sqe *IOURing::getSQE() {
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if (sqe_tail - head >= sq_entries) {
+        return nullptr;
+    }
+    unsigned index = sqe_tail & *sq_mask;
+    sq_array[index] = index;
+    sqe_tail++;
+    io_uring_sqe *sqe = &sqes[index];
+    bzero(sqe, sizeof(io_uring_sqe));
+    return sqe;
+}
+
+int IOURing::submit(unsigned wait_for, int64_t timeout) {
+    unsigned to_submit = sqe_tail - *sq_tail;
+    __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+
+    unsigned flags = wait_for > 0 ? IORING_ENTER_GETEVENTS : 0;
+    io_uring_getevents_arg arg;
+    __kernel_timespec timespec;
+    void *argp = nullptr;
+    size_t argsz = 0;
+    if (wait_for > 0 && timeout >= 0 && (features & IORING_FEAT_EXT_ARG)) {
+        timespec.tv_sec = timeout / 1000000;
+        timespec.tv_nsec = (timeout % 1000000) * 1000;
+        bzero(&arg, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&timespec;
+        flags |= IORING_ENTER_EXT_ARG;
+        argp = &arg;
+        argsz = sizeof(arg);
+    }
+
+    int result;
+    do {
+        result = (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, wait_for, flags, argp, argsz);
+    } while (result < 0 && errno == EINTR && wait_for == 0);
+    return result;
+}
+
+io_uring_cqe *IOURing::peekCQE() {
+    unsigned head = *cq_head;
+    if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+        return nullptr;
+    }
+    return &cqes[head & *cq_mask];
+}
+
+void IOURing::seenCQE() { __atomic_store_n(cq_head, *cq_head + 1, __ATOMIC_RELEASE); }
+
+bool IOURing::provideBuffers(unsigned short group, unsigned count, size_t size) {
+    buffer_ring_size = count * sizeof(io_uring_buf);
+    void *memory = mmap(nullptr, buffer_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+    buffer_ring = (io_uring_buf_ring *)memory;
+
+    // the pages are written before the kernel maps them, so that both use the same ones
+    bzero(memory, buffer_ring_size);
+
+    io_uring_buf_reg registration;
+    bzero(&registration, sizeof(registration));
+    registration.ring_addr = (uint64_t)(uintptr_t)buffer_ring;
+    registration.ring_entries = count;
+    registration.bgid = group;
+    if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PBUF_RING, &registration, 1) != 0) {
+        munmap(buffer_ring, buffer_ring_size);
+        buffer_ring = nullptr;
+        return false;
+    }
+
+    buffer_count = count;
+    buffer_size = size;
+    buffers.resize(count * size);
+    for (unsigned id = 0; id < count; id++) {
+        recycleBuffer(id);
+    }
+    return true;
+}
+
+void IOURing::recycleBuffer(unsigned short id) {
+    // the tail is kept in the reserved field of the first entry, the entry is published by moving it.
+    // The entries start at the ring itself, the bufs member is shifted in C++ by the empty struct of the flexible array
+    io_uring_buf *buffer = (io_uring_buf *)buffer_ring + (buffer_tail & (buffer_count - 1));
+    buffer->addr = (uint64_t)(uintptr_t)getBuffer(id);
+    buffer->len = (uint32_t)buffer_size;
+    buffer->bid = id;
+    buffer_tail++;
+    __atomic_store_n(&buffer_ring->tail, buffer_tail, __ATOMIC_RELEASE);
+}
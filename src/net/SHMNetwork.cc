@@ -0,0 +1,569 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <string>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "misc/Log.h"
+#include "net/SHMNetwork.h"
+
+const int64_t SHMNetwork::SEND_TIMEOUT;
+
+static const size_t RING_SLOTS = 1024;         // messages a ring holds, must be a power of two
+static const int64_t RECEIVE_INTERVAL = 100000; // microseconds between checks, if a receiving thread was cancelled
+static const unsigned short FIRST_FREE_PORT = 32768;
+static const unsigned short LAST_FREE_PORT = 60999;
+
+struct MessageSlot {
+    std::atomic<uint64_t> sequence; // position the slot can be written at, +1 once the message is written
+    unsigned short sender;
+    uint32_t length;
+    char data[MAX_MESSAGE_SIZE];
+};
+
+/**
+ * A bounded queue of messages in shared memory, several processes and threads may write and read it at once.
+ * Every slot carries the position it is ready for, so writers and readers only have to agree on their positions.
+ * The counters of written and read messages are futex words, so the other side can sleep until they change.
+ */
+struct MessageRing {
+    std::atomic<uint32_t> ready; // set once the creator initialized the slots
+    std::atomic<int32_t> owner;  // process which created the ring, the ring of a dead process may be replaced
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) std::atomic<uint32_t> written;
+    std::atomic<uint32_t> waiting_readers;
+    alignas(64) std::atomic<uint32_t> read;
+    std::atomic<uint32_t> waiting_writers;
+    MessageSlot slots[RING_SLOTS];
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2 && sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "futex words must be plain 32 bit integers");
+
+struct RingAttachment {
+    MessageRing *ring;
+    int users;
+    bool owner;  // the owner removes the ring, once it is not used anymore
+    ino_t inode; // of the own ring, the name may not belong to it anymore when it is removed
+};
+
+static std::mutex attachments_mutex;
+static std::map<unsigned short, RingAttachment> attachments; // rings mapped into this process by port
+
+static std::string ringName(unsigned short port) { return "/gameoflife-" + std::to_string(port); }
+
+static void futexWait(std::atomic<uint32_t> *word, uint32_t value, int64_t wait_time) {
+    timespec timeout;
+    timeout.tv_sec = wait_time / 1000000;
+    timeout.tv_nsec = (wait_time % 1000000) * 1000;
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT, value, &timeout, nullptr, 0);
+}
+
+static void futexWake(std::atomic<uint32_t> *word) {
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+static MessageRing *mapRing(int fd) {
+    void *memory = mmap(nullptr, sizeof(MessageRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return memory != MAP_FAILED ? (MessageRing *)memory : nullptr;
+}
+
+/**
+ * Checks if the process which created a ring is gone, e.g. it crashed or exited without waiting for its answers.
+ */
+static bool isOwnerDead(MessageRing *ring) {
+    pid_t owner = ring->owner.load(std::memory_order_acquire);
+    return owner > 0 && kill(owner, 0) == -1 && errno == ESRCH;
+}
+
+/**
+ * Removes the ring of a port, if the process which created it is gone without removing it.
+ *
+ * @return true, if the port is free now
+ */
+static bool removeStaleRing(unsigned short port) {
+    std::string name = ringName(port);
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd == -1) {
+        return errno == ENOENT;
+    }
+
+    // processes checking the same ring take turns, only the first one still finds it under its name,
+    // the others would remove the ring it creates next
+    flock(fd, LOCK_EX);
+    bool stale = false;
+    struct stat status, current_status;
+    int current_fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (current_fd != -1 && fstat(fd, &status) == 0 && fstat(current_fd, &current_status) == 0 &&
+        status.st_ino == current_status.st_ino && (size_t)status.st_size >= sizeof(MessageRing)) {
+        void *memory = mmap(nullptr, sizeof(MessageRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (memory != MAP_FAILED) {
+            stale = isOwnerDead((MessageRing *)memory);
+            munmap(memory, sizeof(MessageRing));
+        }
+        if (stale) {
+            shm_unlink(name.c_str());
+        }
+    }
+    if (current_fd != -1) {
+        close(current_fd);
+    }
+    close(fd);
+    return stale;
+}
+
+/**
+ * Creates the ring of a port, a ring left behind by a process which is gone is replaced.
+ * Sets errno to EADDRINUSE, if the ring of a running process uses the port.
+ *
+ * @param inode is set to the inode of the created ring
+ */
+static MessageRing *createRing(unsigned short port, ino_t &inode) {
+    std::string name = ringName(port);
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1 && errno == EEXIST && removeStaleRing(port)) {
+        fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    }
+    if (fd == -1) {
+        if (errno == EEXIST) {
+            errno = EADDRINUSE;
+        }
+        return nullptr;
+    }
+    struct stat status;
+    if (ftruncate(fd, sizeof(MessageRing)) == -1 || fstat(fd, &status) == -1) {
+        close(fd);
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+    inode = status.st_ino;
+    MessageRing *ring = mapRing(fd);
+    if (ring == nullptr) {
+        shm_unlink(name.c_str());
+        return nullptr;
+    }
+
+    // the memory is zeroed, only the slots need their first position
+    ring->owner.store(getpid(), std::memory_order_release);
+    for (size_t i = 0; i < RING_SLOTS; i++) {
+        ring->slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    ring->ready.store(1, std::memory_order_release);
+    return ring;
+}
+
+static MessageRing *openRing(unsigned short port) {
+    int fd = shm_open(ringName(port).c_str(), O_RDWR, 0);
+    if (fd == -1) {
+        return nullptr;
+    }
+    struct stat status;
+    if (fstat(fd, &status) == -1 || (size_t)status.st_size < sizeof(MessageRing)) {
+        close(fd);
+        return nullptr;
+    }
+    MessageRing *ring = mapRing(fd);
+    if (ring != nullptr && ring->ready.load(std::memory_order_acquire) == 0) {
+        munmap(ring, sizeof(MessageRing));
+        return nullptr;
+    }
+    return ring;
+}
+
+/**
+ * Maps the ring of a port into the process, if it is not mapped yet.
+ *
+ * @param own is true, if the ring receives the messages of the caller, then it is created, if necessary.
+ * Port 0 chooses a free port, which is returned in port.
+ * @return the ring, or nullptr if it does not exist and is not created
+ */
+static MessageRing *attachRing(unsigned short &port, bool own) {
+    std::lock_guard<std::mutex> lock(attachments_mutex);
+    auto search = port != 0 ? attachments.find(port) : attachments.end();
+    if (search != attachments.end()) {
+        search->second.users++;
+        return search->second.ring;
+    }
+
+    MessageRing *ring = nullptr;
+    ino_t inode = 0;
+    if (!own) {
+        ring = openRing(port);
+    } else if (port != 0) {
+        ring = createRing(port, inode);
+    } else {
+        // start at a different port in every process, so that clients starting together rarely collide
+        int range = LAST_FREE_PORT - FIRST_FREE_PORT + 1;
+        for (int i = 0; i < range && ring == nullptr; i++) {
+            unsigned short candidate = FIRST_FREE_PORT + (getpid() + i) % range;
+            if (attachments.count(candidate) > 0) {
+                continue;
+            }
+            ring = createRing(candidate, inode);
+            if (ring != nullptr) {
+                port = candidate;
+            } else if (errno != EADDRINUSE) {
+                break;
+            }
+        }
+    }
+    if (ring != nullptr) {
+        attachments[port] = RingAttachment{ring, 1, own, inode};
+    }
+    return ring;
+}
+
+static void detachRing(unsigned short port) {
+    std::lock_guard<std::mutex> lock(attachments_mutex);
+    auto search = attachments.find(port);
+    if (search == attachments.end() || --search->second.users > 0) {
+        return;
+    }
+    munmap(search->second.ring, sizeof(MessageRing));
+
+    // only the own ring is removed, in case its name was given to the ring of another process meanwhile
+    if (search->second.owner) {
+        std::string name = ringName(port);
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        struct stat status;
+        if (fd != -1 && fstat(fd, &status) == 0 && status.st_ino == search->second.inode) {
+            shm_unlink(name.c_str());
+        }
+        if (fd != -1) {
+            close(fd);
+        }
+    }
+    attachments.erase(search);
+}
+
+static bool tryPush(MessageRing *ring, unsigned short sender, const void *data, size_t length) {
+    uint64_t position = ring->head.load(std::memory_order_relaxed);
+    MessageSlot *slot;
+    while (true) {
+        slot = &ring->slots[position % RING_SLOTS];
+        int64_t difference = (int64_t)slot->sequence.load(std::memory_order_acquire) - (int64_t)position;
+        if (difference == 0) {
+            if (ring->head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            return false; // the slot still holds the message of the previous round
+        } else {
+            position = ring->head.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->sender = sender;
+    slot->length = (uint32_t)length;
+    memcpy(slot->data, data, length);
+    slot->sequence.store(position + 1, std::memory_order_release);
+
+    ring->written.fetch_add(1);
+    if (ring->waiting_readers.load() > 0) {
+        futexWake(&ring->written);
+    }
+    return true;
+}
+
+static ssize_t tryPop(MessageRing *ring, unsigned short &sender, void *data, size_t length) {
+    uint64_t position = ring->tail.load(std::memory_order_relaxed);
+    MessageSlot *slot;
+    while (true) {
+        slot = &ring->slots[position % RING_SLOTS];
+        int64_t difference = (int64_t)slot->sequence.load(std::memory_order_acquire) - (int64_t)(position + 1);
+        if (difference == 0) {
+            if (ring->tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            return -1; // the message is not written yet
+        } else {
+            position = ring->tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    // messages longer than the buffer are cut off
+    sender = slot->sender;
+    size_t copied = std::min((size_t)slot->length, length);
+    memcpy(data, slot->data, copied);
+    slot->sequence.store(position + RING_SLOTS, std::memory_order_release);
+
+    ring->read.fetch_add(1);
+    if (ring->waiting_writers.load() > 0) {
+        futexWake(&ring->read);
+    }
+    return copied;
+}
+
+/**
+ * Copies a message into a ring, if the ring is full, it waits for a reader to make room.
+ *
+ * @return false, if the ring stayed full for the whole wait time
+ */
+static bool push(MessageRing *ring, unsigned short sender, const void *data, size_t length, int64_t wait_time) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(wait_time);
+    while (!tryPush(ring, sender, data, length)) {
+        int64_t remaining =
+            std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0) {
+            return false;
+        }
+
+        // the counter is read before the last try, so a reader in between changes it and the wait returns at once
+        uint32_t read = ring->read.load();
+        ring->waiting_writers.fetch_add(1);
+        if (tryPush(ring, sender, data, length)) {
+            ring->waiting_writers.fetch_sub(1);
+            return true;
+        }
+        futexWait(&ring->read, read, remaining);
+        ring->waiting_writers.fetch_sub(1);
+    }
+    return true;
+}
+
+/**
+ * Takes a message from a ring, if the ring is empty, it waits for a writer.
+ *
+ * @return the length of the message, -1 if the ring stayed empty for the whole wait time
+ */
+static ssize_t pop(MessageRing *ring, unsigned short &sender, void *data, size_t length, int64_t wait_time) {
+    ssize_t received_bytes = tryPop(ring, sender, data, length);
+    if (received_bytes >= 0 || wait_time <= 0) {
+        return received_bytes;
+    }
+
+    uint32_t written = ring->written.load();
+    ring->waiting_readers.fetch_add(1);
+    received_bytes = tryPop(ring, sender, data, length);
+    if (received_bytes < 0) {
+        futexWait(&ring->written, written, wait_time);
+        received_bytes = tryPop(ring, sender, data, length);
+    }
+    ring->waiting_readers.fetch_sub(1);
+    return received_bytes;
+}
+
+static void setAddress(IPAddress &address, unsigned short port) {
+    bzero(&address, sizeof(address));
+    address.sin_family = AF_INET;
+    address.setAddr(INADDR_LOOPBACK);
+    address.setPort(port);
+}
+
+SHMNetwork::SHMNetwork(short port) : port(port) {
+    ring = attachRing(this->port, true);
+    if (ring == nullptr) {
+        LOG(ERROR) << "Shared memory for port " << port << " could not be created";
+        LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+        this->port = 0;
+    }
+}
+
+SHMNetwork::SHMNetwork() : SHMNetwork(0) {}
+
+SHMNetwork::~SHMNetwork() {
+    for (auto target : targets) {
+        detachRing(target.first);
+    }
+    if (ring != nullptr) {
+        detachRing(port);
+    }
+}
+
+MessageRing *SHMNetwork::getRing(unsigned short target_port) {
+    std::lock_guard<std::mutex> lock(targets_mutex);
+    auto search = targets.find(target_port);
+    if (search != targets.end()) {
+        return search->second;
+    }
+    MessageRing *target = attachRing(target_port, false);
+    if (target != nullptr) {
+        targets[target_port] = target;
+    }
+    return target;
+}
+
+ssize_t SHMNetwork::request(const Server &server, void *req, size_t reqlen, void *res, size_t reslen, int timeout) {
+    // clear buffer !!!
+    bzero(res, reslen);
+
+    return wait(submit(server, req, reqlen, res, reslen), timeout);
+}
+
+int SHMNetwork::submit(const Server &server, void *req, size_t reqlen, void *res, size_t reslen) {
+    if (ring == nullptr) {
+        LOG(ERROR) << "No shared memory exists";
+        return -1;
+    }
+
+    if (reqlen > MAX_MESSAGE_SIZE) {
+        LOG(ERROR) << "Request of " << reqlen << " bytes does not fit into a slot";
+        return -1;
+    }
+
+    // entries are reused, so that only the first requests in flight allocate memory
+    int handle;
+    if (free_handles.empty()) {
+        handle = (int)pending.size();
+        pending.emplace_back();
+    } else {
+        handle = free_handles.back();
+        free_handles.pop_back();
+    }
+    PendingRequest &pending_request = pending[handle];
+    pending_request.used = true;
+    pending_request.server = server;
+    memcpy(pending_request.request, req, reqlen);
+    pending_request.request_length = reqlen;
+    pending_request.sequence_number = ((Message *)req)->getSequenceNumber();
+    pending_request.res = res;
+    pending_request.reslen = reslen;
+    pending_request.received_bytes = -1;
+
+    MessageRing *target = getRing(server.getPort());
+    pending_request.sent = target != nullptr && push(target, port, req, reqlen, SEND_TIMEOUT);
+    return handle;
+}
+
+void SHMNetwork::sendPending() {
+    for (PendingRequest &pending_request : pending) {
+        if (!pending_request.used || pending_request.sent) {
+            continue;
+        }
+        LOG(DEBUG) << "Server not reachable, retry";
+        MessageRing *target = getRing(pending_request.server.getPort());
+        pending_request.sent = target != nullptr && push(target, port, pending_request.request,
+                                                         pending_request.request_length, SEND_TIMEOUT);
+    }
+}
+
+void SHMNetwork::receiveAnswers(int64_t wait_time) {
+    char buffer[MAX_MESSAGE_SIZE];
+    unsigned short sender;
+    ssize_t received_bytes;
+    while ((received_bytes = pop(ring, sender, buffer, sizeof(buffer), wait_time)) >= 0) {
+        wait_time = 0;
+        if ((size_t)received_bytes < sizeof(Message)) {
+            continue;
+        }
+        unsigned int sequence_number = ((Message *)buffer)->getSequenceNumber();
+        for (PendingRequest &pending_request : pending) {
+            if (pending_request.used && pending_request.received_bytes < 0 &&
+                pending_request.sequence_number == sequence_number) {
+                pending_request.received_bytes = std::min((size_t)received_bytes, pending_request.reslen);
+                memcpy(pending_request.res, buffer, pending_request.received_bytes);
+                break;
+            }
+        }
+    }
+}
+
+bool SHMNetwork::poll(int handle) {
+    if (ring != nullptr) {
+        receiveAnswers(0);
+    }
+    return handle >= 0 && (size_t)handle < pending.size() && pending[handle].used &&
+           pending[handle].received_bytes >= 0;
+}
+
+ssize_t SHMNetwork::wait(int handle, int timeout) {
+    return waitUntil(handle, timeout, std::chrono::steady_clock::time_point::max());
+}
+
+ssize_t SHMNetwork::waitFor(int handle, int limit) {
+    return waitUntil(handle, 1, std::chrono::steady_clock::now() + std::chrono::milliseconds(limit));
+}
+
+ssize_t SHMNetwork::waitUntil(int handle, int timeout, std::chrono::steady_clock::time_point deadline) {
+    if (handle < 0 || (size_t)handle >= pending.size() || !pending[handle].used) {
+        return -1;
+    }
+    PendingRequest &request = pending[handle];
+
+    // a sent request is answered for sure, the timeout only paces the requests which could not be sent yet
+    while (request.received_bytes < 0) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            break;
+        }
+        sendPending();
+        int64_t remaining = std::chrono::duration_cast<std::chrono::microseconds>(deadline - now).count();
+        receiveAnswers(std::min((int64_t)std::max(timeout, 1) * 1000000, remaining));
+    }
+
+    request.used = false;
+    free_handles.push_back(handle);
+    return request.received_bytes;
+}
+
+ssize_t SHMNetwork::receive(Client &client, void *req, size_t reqlen) {
+    ssize_t length;
+    int count = receiveBatch(&client, req, reqlen, &length, 1);
+    return count == 1 ? length : -1;
+}
+
+int SHMNetwork::receiveBatch(Client *clients, void *reqs, size_t reqlen, ssize_t *lengths, int count) {
+    if (ring == nullptr) {
+        LOG(ERROR) << "No shared memory exists";
+        return -1;
+    }
+
+    // blocks until a message arrives, the thread may be cancelled meanwhile
+    unsigned short sender;
+    while ((lengths[0] = pop(ring, sender, reqs, reqlen, RECEIVE_INTERVAL)) < 0) {
+        pthread_testcancel();
+    }
+    setAddress(clients[0], sender);
+
+    // then takes all which are already there
+    int received = 1;
+    while (received < count &&
+           (lengths[received] = tryPop(ring, sender, (char *)reqs + received * reqlen, reqlen)) >= 0) {
+        setAddress(clients[received], sender);
+        received++;
+    }
+    return received;
+}
+
+ssize_t SHMNetwork::reply(const Client &client, void *res, size_t reslen) {
+    if (ring == nullptr) {
+        LOG(ERROR) << "No shared memory exists";
+        return -1;
+    }
+
+    if (reslen > MAX_MESSAGE_SIZE) {
+        LOG(ERROR) << "Reply of " << reslen << " bytes does not fit into a slot";
+        return -1;
+    }
+
+    // requests which reached the server are not sent again, so the reply waits until the client makes room,
+    // unless the client is gone
+    MessageRing *target = getRing(client.getPort());
+    while (target != nullptr && !push(target, port, res, reslen, SEND_TIMEOUT)) {
+        if (isOwnerDead(target)) {
+            target = nullptr;
+            break;
+        }
+        LOG(WARN) << "Client " << (unsigned short)client.getPort() << " does not take its answers, still waiting";
+    }
+    if (target == nullptr) {
+        LOG(ERROR) << "Could not send message to client " << (unsigned short)client.getPort();
+        return -1;
+    }
+    return reslen;
+}
+
+short SHMNetwork::getPort() { return ring != nullptr ? (short)port : 0; }
@@ -1,6 +1,16 @@
 #include "net/TCPNetwork.h"
 #include "misc/Log.h"
+#include "net/Message.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
 #include <exception>
+#include <fcntl.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <system_error>
@@ -42,6 +52,28 @@ TCPNetwork::TCPNetwork(short port, int queue_size) {
         throw std::system_error(errno, std::generic_category(),
                                 "Could not make server socket listen for incoming connections");
     }
+
+    // the listen socket is edge-triggered, so all pending connections are accepted at once until none is left
+    fcntl(socket_fd, F_SETFL, fcntl(socket_fd, F_GETFL, 0) | O_NONBLOCK);
+    epoll_fd = epoll_create1(0);
+    if (epoll_fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Could not create epoll instance");
+    }
+    epoll_event event;
+    event.events = EPOLLIN | EPOLLET;
+    event.data.fd = socket_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, socket_fd, &event) != 0) {
+        throw std::system_error(errno, std::generic_category(), "Could not monitor server socket");
+    }
+
+#ifdef USE_IO_URING
+    send_ring = new IOURing(URING_ENTRIES);
+    if (!send_ring->isValid()) {
+        LOG(WARN) << "io_uring is not available, using system calls for every operation";
+        delete send_ring;
+        send_ring = nullptr;
+    }
+#endif
 }
 
 TCPNetwork::TCPNetwork() {
@@ -49,7 +81,13 @@ TCPNetwork::TCPNetwork() {
 }
 
 TCPNetwork::~TCPNetwork() {
+#ifdef USE_IO_URING
+    delete send_ring;
+#endif
     // close all open sockets
+    if (epoll_fd != -1) {
+        close(epoll_fd);
+    }
     close(socket_fd);
     for (auto elem : connections) {
         close(elem.second);
@@ -60,117 +98,475 @@ ssize_t TCPNetwork::request(const Server &server, void *req, size_t reqlen, void
     // clear buffer
     bzero(res, reslen);
 
-    // check if socket exists, if not create connection with server
-    if (socket_fd == -1) {
-        socket_fd = socket(AF_INET, SOCK_STREAM, 0);
-        if (socket_fd < 0) {
-            throw std::system_error(errno, std::generic_category(), "Could not create socket");
-        }
+    getConnection(server, timeout);
+    return wait(submit(server, req, reqlen, res, reslen), timeout);
+}
 
-        socklen_t server_address_len = sizeof(server);
-        while (connect(socket_fd, (const sockaddr *)&server, server_address_len) != 0) {
-            if (errno == ECONNREFUSED) {
-                LOG(INFO) << "Server does not exist, waiting...";
-                sleep(timeout);
-            } else {
-                throw std::system_error(errno, std::generic_category(), "Could not connect to the server");
-            }
+int TCPNetwork::submit(const Server &server, void *req, size_t reqlen, void *res, size_t reslen) {
+    int connection_fd = getConnection(server, 1);
+    if (sendMessage(connection_fd, req, reqlen) < 0) {
+        throw std::system_error(errno, std::generic_category(), "Could not send request to server");
+    }
+
+    // entries are reused, so that only the first requests in flight allocate memory
+    int handle;
+    if (free_handles.empty()) {
+        handle = (int)pending.size();
+        pending.emplace_back();
+    } else {
+        handle = free_handles.back();
+        free_handles.pop_back();
+    }
+    PendingRequest &pending_request = pending[handle];
+    pending_request.used = true;
+    pending_request.connection_fd = connection_fd;
+    pending_request.sequence_number = ((Message *)req)->getSequenceNumber();
+    pending_request.res = res;
+    pending_request.reslen = reslen;
+    pending_request.received_bytes = -1;
+    return handle;
+}
+
+bool TCPNetwork::poll(int handle) {
+    if (handle < 0 || (size_t)handle >= pending.size() || !pending[handle].used) {
+        return false;
+    }
+    PendingRequest &request = pending[handle];
+    while (request.received_bytes < 0 && receiveAnswer(request.connection_fd, false)) {
+    }
+    return request.received_bytes >= 0;
+}
+
+ssize_t TCPNetwork::wait(int handle, int timeout) {
+    if (handle < 0 || (size_t)handle >= pending.size() || !pending[handle].used) {
+        return -1;
+    }
+    PendingRequest &request = pending[handle];
+
+    // answers arrive in the order of the requests on a connection, but other requests may be answered first
+    while (request.received_bytes < 0) {
+        if (!receiveAnswer(request.connection_fd, true)) {
+            LOG(ERROR) << "Connection to the server was closed";
+            request.received_bytes = 0;
         }
     }
 
-    // send request
-    ssize_t send_bytes = send(socket_fd, req, reqlen, 0);
+    request.used = false;
+    free_handles.push_back(handle);
+    return request.received_bytes;
+}
 
-    if (send_bytes < 0) {
-        throw std::system_error(errno, std::generic_category(), "Could not send request to server");
+ssize_t TCPNetwork::waitFor(int handle, int limit) {
+    if (handle < 0 || (size_t)handle >= pending.size() || !pending[handle].used) {
+        return -1;
+    }
+    PendingRequest &request = pending[handle];
+
+    // the connection does not lose messages, so the request is only given up, if its answer is late
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(limit);
+    while (request.received_bytes < 0) {
+        int64_t remaining =
+            std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        pollfd connection = {request.connection_fd, POLLIN | POLLRDHUP, 0};
+        int ready = remaining > 0 ? ::poll(&connection, 1, (int)remaining) : 0;
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0) {
+            break;
+        }
+        while (request.received_bytes < 0 && receiveAnswer(request.connection_fd, false)) {
+        }
+        if (request.received_bytes < 0 && (connection.revents & (POLLRDHUP | POLLHUP | POLLERR)) != 0) {
+            LOG(ERROR) << "Connection to the server was closed";
+            request.received_bytes = 0;
+        }
     }
 
-    // receive reply (wait until socket has one though)
-    fd_set rset;
-    FD_ZERO(&rset);
-    FD_SET(socket_fd, &rset);
+    request.used = false;
+    free_handles.push_back(handle);
+    return request.received_bytes;
+}
 
-    if (select(socket_fd + 1, &rset, NULL, NULL, NULL) < 0) {
-        throw std::system_error(errno, std::generic_category(), "Could not monitor socket descriptors");
+bool TCPNetwork::receiveAnswer(int connection_fd, bool block) {
+    auto search = sockets.find(connection_fd);
+    if (search == sockets.end()) {
+        return false;
     }
+    Connection &connection = search->second;
 
-    if (FD_ISSET(socket_fd, &rset)) {
-        ssize_t received_bytes = recv(socket_fd, res, reslen, 0);
-        if (received_bytes < 0) {
-            throw std::system_error(errno, std::generic_category(), "Could not receive reply from server");
+    char buffer[MAX_MESSAGE_SIZE];
+    ssize_t received_bytes;
+    while (!takeMessage(connection, buffer, sizeof(buffer), received_bytes)) {
+        // a blocking read interrupted by a signal is tried again, only a closed connection ends the wait
+        ssize_t read_bytes = readInput(connection_fd, connection, block);
+        if (read_bytes < 0 && block && errno == EINTR) {
+            continue;
+        }
+        if (read_bytes <= 0) {
+            return false;
         }
-        return received_bytes;
     }
 
-    // our connection must be the one set in the FD set, otherwise it was malformed.
-    throw std::logic_error("Select returned an impossible network state, possibly malformed fd_set");
+    if ((size_t)received_bytes < sizeof(Message)) {
+        return true;
+    }
+    unsigned int sequence_number = ((Message *)buffer)->getSequenceNumber();
+    for (PendingRequest &pending_request : pending) {
+        if (pending_request.used && pending_request.connection_fd == connection_fd &&
+            pending_request.received_bytes < 0 && pending_request.sequence_number == sequence_number) {
+            pending_request.received_bytes = std::min((size_t)received_bytes, pending_request.reslen);
+            memcpy(pending_request.res, buffer, pending_request.received_bytes);
+            break;
+        }
+    }
+    return true;
 }
 
 ssize_t TCPNetwork::receive(Client &client, void *req, size_t reqlen) {
     // clear buffer
     bzero(req, reqlen);
 
-    int max_fd = socket_fd;
-    fd_set rset;
-    FD_ZERO(&rset);
-    FD_SET(socket_fd, &rset);
-    for (auto elem : connections) {
-        FD_SET(elem.second, &rset);
-        max_fd = max(max_fd, elem.second);
-    }
+    while (true) {
+        // wait for sockets to become ready, only if no socket is left over from the last wait
+        if (ready_head == ready.size()) {
+            ready.clear();
+            ready_head = 0;
+            epoll_event events[EPOLL_MAX_EVENTS];
+            int event_count = epoll_wait(epoll_fd, events, EPOLL_MAX_EVENTS, -1);
+            if (event_count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::system_error(errno, std::generic_category(), "Could not monitor socket descriptors");
+            }
+            for (int i = 0; i < event_count; i++) {
+                ready.push_back(events[i].data.fd);
+            }
+        }
+
+        int connection_fd = ready[ready_head++];
+
+        // sockets with more requests are queued again, drop the handled ones before the queue keeps growing
+        if (ready_head >= (size_t)EPOLL_MAX_EVENTS && ready_head * 2 >= ready.size()) {
+            ready.erase(ready.begin(), ready.begin() + ready_head);
+            ready_head = 0;
+        }
+
+        if (connection_fd == socket_fd) {
+            acceptConnections();
+            continue;
+        }
+
+        auto search = sockets.find(connection_fd);
+        if (search == sockets.end()) {
+            continue;
+        }
+        Connection &connection = search->second;
+
+        // the socket stays ready until a receive would block, there is no new event before
+        ssize_t received_bytes;
+        bool closed = false;
+        if (!takeMessage(connection, req, reqlen, received_bytes)) {
+            ssize_t read_bytes;
+            while ((read_bytes = readInput(connection_fd, connection, false)) > 0) {
+            }
+            closed = read_bytes == 0;
+
+            if (!takeMessage(connection, req, reqlen, received_bytes)) {
+                // the client closed the connection, stop monitoring it and wait for the next request
+                if (closed) {
+                    closeConnection(connection_fd);
+                }
+                continue;
+            }
+        }
 
-    if (select(max_fd + 1, &rset, NULL, NULL, NULL) < 0) {
-        throw std::system_error(errno, std::generic_category(), "Could not monitor socket descriptors");
+        // check the socket again later, if it holds more requests or was closed
+        if (closed || hasMessage(connection)) {
+            ready.push_back(connection_fd);
+        }
+        client = connection.address;
+        return received_bytes;
     }
+}
 
-    if (FD_ISSET(socket_fd, &rset)) {
-        // accept new connection on listen socket and store it
+void TCPNetwork::acceptConnections() {
+    while (true) {
+        IPAddress client;
         socklen_t size_of_client = sizeof(client);
         int connection_fd = accept(socket_fd, (sockaddr *)&client, &size_of_client);
         if (connection_fd < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                return;
+            }
             throw std::system_error(errno, std::generic_category(), "Could not accept connection from client");
         }
-        connections[client] = connection_fd;
 
-        ssize_t received_bytes = recv(connection_fd, req, reqlen, 0);
+        // replies are small and must not wait for more data
+        int optval = 1;
+        setsockopt(connection_fd, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval));
 
-        if (received_bytes < 0) {
-            throw std::system_error(errno, std::generic_category(), "Could not receive request from client");
+        epoll_event event;
+        event.events = EPOLLIN | EPOLLET;
+        event.data.fd = connection_fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connection_fd, &event) != 0) {
+            throw std::system_error(errno, std::generic_category(), "Could not monitor connection to client");
+        }
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex);
+            connections[client] = connection_fd;
+            sockets[connection_fd].address = client;
         }
-        return received_bytes;
 
-    } else {
-        // retrieve first connection that send us something
-        int connection_fd = -1;
-        for (auto elem : connections) {
-            if (FD_ISSET(elem.second, &rset)) {
-                connection_fd = elem.second;
-                client.setAddr(elem.first.getAddr());
-                client.setPort(elem.first.getPort());
-                break;
-            }
+        // the request may have arrived before the socket was monitored
+        ready.push_back(connection_fd);
+    }
+}
+
+int TCPNetwork::getConnection(const Server &server, int timeout) {
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        auto search = connections.find(server);
+        if (search != connections.end()) {
+            return search->second;
         }
+    }
 
-        ssize_t received_bytes = recv(connection_fd, req, reqlen, 0);
+    int connection_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connection_fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Could not create socket");
+    }
 
-        if (received_bytes < 0) {
-            throw std::system_error(errno, std::generic_category(), "Could not receive request from client");
+    socklen_t server_address_len = sizeof(server);
+    while (connect(connection_fd, (const sockaddr *)&server, server_address_len) != 0) {
+        if (errno == ECONNREFUSED) {
+            LOG(INFO) << "Server does not exist, waiting...";
+            sleep(timeout);
+        } else {
+            throw std::system_error(errno, std::generic_category(), "Could not connect to the server");
         }
-        return received_bytes;
     }
 
-    // must be on of our connections to clients or the listening socket, otherwise some socket magically created itself
-    throw std::logic_error("Select returned an impossible network state, possibly malformed fd_set or magic socket");
+    // requests are small and must not wait for more data
+    int optval = 1;
+    setsockopt(connection_fd, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval));
+
+    std::lock_guard<std::mutex> lock(connections_mutex);
+    connections[server] = connection_fd;
+    sockets[connection_fd].address = server;
+    return connection_fd;
+}
+
+void TCPNetwork::closeConnection(int connection_fd) {
+    std::lock_guard<std::mutex> lock(connections_mutex);
+    if (epoll_fd != -1) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, connection_fd, NULL);
+    }
+    close(connection_fd);
+    ready.erase(std::remove(ready.begin() + ready_head, ready.end(), connection_fd), ready.end());
+    auto search = sockets.find(connection_fd);
+    if (search != sockets.end()) {
+        connections.erase(search->second.address);
+        sockets.erase(search);
+    }
+}
+
+ssize_t TCPNetwork::readInput(int connection_fd, Connection &connection, bool block) {
+    char chunk[4096];
+    ssize_t read_bytes = recv(connection_fd, chunk, sizeof(chunk), block ? 0 : MSG_DONTWAIT);
+    if (read_bytes < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return -1;
+        }
+        throw std::system_error(errno, std::generic_category(), "Could not receive message");
+    }
+
+    // the messages taken since the last read are removed at once, instead of moving the input for every message
+    if (connection.input_offset > 0) {
+        connection.input.erase(connection.input.begin(), connection.input.begin() + connection.input_offset);
+        connection.input_offset = 0;
+    }
+    connection.input.insert(connection.input.end(), chunk, chunk + read_bytes);
+    return read_bytes;
+}
+
+bool TCPNetwork::hasMessage(Connection &connection) {
+    size_t available = connection.input.size() - connection.input_offset;
+    if (available < sizeof(uint32_t)) {
+        return false;
+    }
+    uint32_t length;
+    memcpy(&length, connection.input.data() + connection.input_offset, sizeof(length));
+    return available >= sizeof(uint32_t) + ntohl(length);
+}
+
+bool TCPNetwork::takeMessage(Connection &connection, void *buffer, size_t length, ssize_t &message_length) {
+    if (!hasMessage(connection)) {
+        return false;
+    }
+    const char *frame = connection.input.data() + connection.input_offset;
+    uint32_t frame_length;
+    memcpy(&frame_length, frame, sizeof(frame_length));
+    frame_length = ntohl(frame_length);
+
+    message_length = std::min((size_t)frame_length, length);
+    memcpy(buffer, frame + sizeof(uint32_t), message_length);
+    connection.input_offset += sizeof(uint32_t) + frame_length;
+    return true;
+}
+
+ssize_t TCPNetwork::sendMessage(int connection_fd, void *data, size_t length) {
+    uint32_t header = htonl((uint32_t)length);
+    iovec buffers[2];
+    buffers[0].iov_base = &header;
+    buffers[0].iov_len = sizeof(header);
+    buffers[1].iov_base = data;
+    buffers[1].iov_len = length;
+    return writeAll(connection_fd, buffers, 2) ? (ssize_t)length : -1;
+}
+
+bool TCPNetwork::writeAll(int connection_fd, iovec *buffers, int count) {
+    while (count > 0) {
+        ssize_t written = writev(connection_fd, buffers, count);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        // skip what was written, continue within a partly written buffer
+        while (count > 0 && (size_t)written >= buffers->iov_len) {
+            written -= buffers->iov_len;
+            buffers++;
+            count--;
+        }
+        if (count > 0) {
+            buffers->iov_base = (char *)buffers->iov_base + written;
+            buffers->iov_len -= written;
+        }
+    }
+    return true;
 }
 
 ssize_t TCPNetwork::reply(const Client &client, void *res, size_t reslen) {
+    std::lock_guard<std::mutex> lock(connections_mutex);
     auto search = connections.find(client);
     if (search == connections.end()) {
         throw std::invalid_argument("Given client is not known");
     }
+    return sendMessage(search->second, res, reslen);
+}
+
+ssize_t TCPNetwork::queueReply(const Client &client, void *res, size_t reslen) {
+    std::lock_guard<std::mutex> lock(connections_mutex);
+    auto search = connections.find(client);
+    if (search == connections.end()) {
+        return -1;
+    }
+
+    std::vector<char> &output = sockets[search->second].output;
+    if (output.empty()) {
+        queued.push_back(search->second);
+    }
+    uint32_t header = htonl((uint32_t)reslen);
+    output.insert(output.end(), (char *)&header, (char *)&header + sizeof(header));
+    output.insert(output.end(), (char *)res, (char *)res + reslen);
+    return reslen;
+}
+
+void TCPNetwork::flush() {
+    std::lock_guard<std::mutex> lock(connections_mutex);
+#ifdef USE_IO_URING
+    if (send_ring != nullptr) {
+        flushURing();
+    }
+#endif
+    for (int connection_fd : queued) {
+        auto search = sockets.find(connection_fd);
+        if (search == sockets.end()) {
+            continue;
+        }
+        std::vector<char> &output = search->second.output;
+        iovec buffer;
+        buffer.iov_base = output.data();
+        buffer.iov_len = output.size();
+        if (!writeAll(connection_fd, &buffer, 1)) {
+            LOG(ERROR) << "Could not send replies to " << search->second.address.getAddr() << ":"
+                       << search->second.address.getPort();
+        }
+        output.clear();
+    }
+    queued.clear();
+}
+
+short TCPNetwork::getPort() {
+    IPAddress address;
+    socklen_t address_len = sizeof(address);
+    if (socket_fd == -1 || getsockname(socket_fd, (sockaddr *)&address, &address_len) == -1) {
+        return 0;
+    }
+    return address.getPort();
+}
 
-    int connection_fd = search->second;
-    ssize_t send_bytes = send(connection_fd, res, reslen, 0);
+#ifdef USE_IO_URING
+void TCPNetwork::flushURing() {
+    // connections which were closed meanwhile are skipped
+    queued.erase(std::remove_if(queued.begin(), queued.end(),
+                                [this](int connection_fd) { return sockets.count(connection_fd) == 0; }),
+                 queued.end());
 
-    return send_bytes;
+    size_t sent = 0;
+    while (sent < queued.size()) {
+        // the replies of as many connections as fit into the ring are submitted with a single system call
+        unsigned batch = 0;
+        io_uring_sqe *sqe;
+        while (sent + batch < queued.size() && (sqe = send_ring->getSQE()) != nullptr) {
+            std::vector<char> &output = sockets[queued[sent + batch]].output;
+            sqe->opcode = IORING_OP_SEND;
+            sqe->fd = queued[sent + batch];
+            sqe->addr = (uint64_t)(uintptr_t)output.data();
+            sqe->len = (uint32_t)output.size();
+            sqe->msg_flags = MSG_WAITALL | MSG_NOSIGNAL;
+            sqe->user_data = sent + batch;
+            batch++;
+        }
+
+        unsigned completed = 0;
+        while (completed < batch) {
+            io_uring_cqe *cqe = send_ring->peekCQE();
+            if (cqe == nullptr) {
+                if (send_ring->submit(batch - completed) < 0 && errno != EINTR && errno != EAGAIN) {
+                    // the rest is sent by the system calls
+                    LOG(ERROR) << "Could not submit replies to clients";
+                    LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+                    queued.erase(queued.begin(), queued.begin() + sent);
+                    return;
+                }
+                continue;
+            }
+
+            int connection_fd = queued[cqe->user_data];
+            Connection &connection = sockets[connection_fd];
+            bool written = cqe->res >= 0;
+            if (written && (size_t)cqe->res < connection.output.size()) {
+                iovec buffer;
+                buffer.iov_base = connection.output.data() + cqe->res;
+                buffer.iov_len = connection.output.size() - cqe->res;
+                written = writeAll(connection_fd, &buffer, 1);
+            }
+            if (!written) {
+                LOG(ERROR) << "Could not send replies to " << connection.address.getAddr() << ":"
+                           << connection.address.getPort();
+            }
+            connection.output.clear();
+            send_ring->seenCQE();
+            completed++;
+        }
+        sent += batch;
+    }
+    queued.clear();
 }
+#endif
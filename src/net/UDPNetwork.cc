@@ -1,11 +1,23 @@
+#include <algorithm>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include "misc/Log.h"
+#include "net/Message.h"
 #include "net/UDPNetwork.h"
 
+#ifdef USE_IO_URING
+#include <pthread.h>
+#endif
+
+const int64_t UDPNetwork::INITIAL_RTO;
+const int64_t UDPNetwork::MIN_RTO;
+const int64_t UDPNetwork::MAX_RTO;
+const size_t UDPNetwork::REPLY_WINDOW;
+
 UDPNetwork::UDPNetwork(short port) {
     // open socket
     // bind port
@@ -16,6 +28,10 @@ UDPNetwork::UDPNetwork(short port) {
         return;
     }
 
+    // several sockets may share the port, the system distributes the clients among them
+    int optval = 1;
+    setsockopt(socket_fd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval));
+
     IPAddress ipaddress = IPAddress(port);
     int bind_result = bind(socket_fd, (const sockaddr *)&ipaddress, sizeof(ipaddress));
     if (bind_result == -1) {
@@ -23,6 +39,10 @@ UDPNetwork::UDPNetwork(short port) {
         LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
         return;
     }
+
+#ifdef USE_IO_URING
+    setupURing();
+#endif
 }
 
 UDPNetwork::UDPNetwork() {
@@ -36,9 +56,16 @@ UDPNetwork::UDPNetwork() {
 }
 
 UDPNetwork::~UDPNetwork() {
+#ifdef USE_IO_URING
+    delete receive_ring;
+    delete send_ring;
+#endif
     if (socket_fd != -1) {
         close(socket_fd);
     }
+    if (group_fd != -1) {
+        close(group_fd);
+    }
 }
 
 ssize_t UDPNetwork::request(const Server &server, void *req, size_t reqlen, void *res, size_t reslen, int timeout) {
@@ -47,46 +74,201 @@ ssize_t UDPNetwork::request(const Server &server, void *req, size_t reqlen, void
         return -1;
     }
 
-    socklen_t server_address_len = sizeof(server);
-
     // clear buffer !!!
     bzero(res, reslen);
 
-    // loop
-    while (true) {
-        // send
-        ssize_t send_bytes = sendto(socket_fd, req, reqlen, 0, (const sockaddr *)&server, server_address_len);
-        if (send_bytes == -1) {
-            LOG(ERROR) << "Could not send a request to the server";
-            LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+    return wait(submit(server, req, reqlen, res, reslen), timeout);
+}
+
+int UDPNetwork::submit(const Server &server, void *req, size_t reqlen, void *res, size_t reslen) {
+    if (socket_fd == -1) {
+        LOG(ERROR) << "No socket exists";
+        return -1;
+    }
+
+    if (reqlen > MAX_MESSAGE_SIZE) {
+        LOG(ERROR) << "Request of " << reqlen << " bytes does not fit into a datagram";
+        return -1;
+    }
+
+    // entries are reused, so that only the first requests in flight allocate memory
+    int handle;
+    if (free_handles.empty()) {
+        handle = (int)pending.size();
+        pending.emplace_back();
+    } else {
+        handle = free_handles.back();
+        free_handles.pop_back();
+    }
+    PendingRequest &pending_request = pending[handle];
+    pending_request.used = true;
+    pending_request.server = server;
+    memcpy(pending_request.request, req, reqlen);
+    pending_request.request_length = reqlen;
+    pending_request.sequence_number = ((Message *)req)->getSequenceNumber();
+    pending_request.res = res;
+    pending_request.reslen = reslen;
+    pending_request.received_bytes = -1;
+    pending_request.sent_at = Clock::now();
+    pending_request.timeout = rto;
+    pending_request.sent_again = false;
+    message_type_t type = ((Message *)req)->getType();
+    pending_request.waits_for_others = type == message_type_t::logon || type == message_type_t::barrier;
+    pending_request.group_answer = false;
+
+    ssize_t send_bytes = sendto(socket_fd, req, reqlen, 0, (const sockaddr *)&server, sizeof(server));
+    if (send_bytes == -1) {
+        LOG(ERROR) << "Could not send a request to the server";
+        LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+    }
+    return handle;
+}
+
+int UDPNetwork::submitGroup(const Server &server, void *req, size_t reqlen, void *res, size_t reslen,
+                            unsigned int group_sequence_number) {
+    int handle = submit(server, req, reqlen, res, reslen);
+    if (handle != -1 && group_fd != -1) {
+        pending[handle].group_answer = true;
+        pending[handle].waits_for_others = true;
+        pending[handle].group_sequence_number = group_sequence_number;
+    }
+    return handle;
+}
+
+bool UDPNetwork::poll(int handle) {
+    while (receiveAnswer(socket_fd, MSG_DONTWAIT)) {
+    }
+    while (group_fd != -1 && receiveAnswer(group_fd, MSG_DONTWAIT)) {
+    }
+    return handle >= 0 && (size_t)handle < pending.size() && pending[handle].used &&
+           pending[handle].received_bytes >= 0;
+}
+
+ssize_t UDPNetwork::wait(int handle, int timeout) { return waitUntil(handle, timeout, Clock::time_point::max()); }
+
+ssize_t UDPNetwork::waitFor(int handle, int limit) {
+    return waitUntil(handle, 1, Clock::now() + std::chrono::milliseconds(limit));
+}
+
+ssize_t UDPNetwork::waitUntil(int handle, int timeout, Clock::time_point deadline) {
+    if (handle < 0 || (size_t)handle >= pending.size() || !pending[handle].used) {
+        return -1;
+    }
+    PendingRequest &request = pending[handle];
+
+    int64_t max_timeout = std::min(MAX_RTO, (int64_t)timeout * 1000000);
+    while (request.received_bytes < 0) {
+        // wait until the next unanswered request is due to be sent again, or the request is given up
+        Clock::time_point now = Clock::now();
+        if (now >= deadline) {
+            break;
+        }
+        int64_t wait_time = std::chrono::duration_cast<std::chrono::microseconds>(deadline - now).count();
+        wait_time = std::min(wait_time, max_timeout);
+        for (PendingRequest &pending_request : pending) {
+            if (pending_request.used && pending_request.received_bytes < 0) {
+                int64_t elapsed =
+                    std::chrono::duration_cast<std::chrono::microseconds>(now - pending_request.sent_at).count();
+                wait_time = std::min(wait_time, std::min(pending_request.timeout, max_timeout) - elapsed);
+            }
         }
 
         // use select for timeout, see manpages for further information for select
         fd_set rset;
         FD_ZERO(&rset);
         FD_SET(socket_fd, &rset);
+        if (group_fd != -1) {
+            FD_SET(group_fd, &rset);
+        }
         timeval select_timeout;
-        select_timeout.tv_usec = 0;
-        select_timeout.tv_sec = timeout;
-        int nready = select(socket_fd + 1, &rset, NULL, NULL, &select_timeout);
+        select_timeout.tv_sec = std::max((int64_t)0, wait_time) / 1000000;
+        select_timeout.tv_usec = std::max((int64_t)0, wait_time) % 1000000;
+        int nready = select(std::max(socket_fd, group_fd) + 1, &rset, NULL, NULL, &select_timeout);
         if (nready == -1) {
             LOG(ERROR) << "Could not monitor file descriptor with select";
             LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
         }
 
-        if (FD_ISSET(socket_fd, &rset)) {
-            // if not timeout return data
-            ssize_t received_bytes = recvfrom(socket_fd, res, reslen, 0, (sockaddr *)&server, &server_address_len);
-            if (received_bytes == -1) {
-                LOG(ERROR) << "Could not receive answer from server";
-                LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+        if (nready > 0) {
+            if (FD_ISSET(socket_fd, &rset)) {
+                receiveAnswer(socket_fd, 0);
             }
-            return received_bytes;
+            if (group_fd != -1 && FD_ISSET(group_fd, &rset)) {
+                receiveAnswer(group_fd, 0);
+            }
+            continue;
+        }
+
+        // requests or their answers got lost, send the overdue requests again and back off
+        now = Clock::now();
+        for (PendingRequest &pending_request : pending) {
+            int64_t elapsed =
+                std::chrono::duration_cast<std::chrono::microseconds>(now - pending_request.sent_at).count();
+            if (!pending_request.used || pending_request.received_bytes >= 0 ||
+                elapsed < std::min(pending_request.timeout, max_timeout)) {
+                continue;
+            }
+            LOG(DEBUG) << "Request timeout exceeded, retry";
+            sendto(socket_fd, pending_request.request, pending_request.request_length, 0,
+                   (const sockaddr *)&pending_request.server, sizeof(pending_request.server));
+            pending_request.sent_at = now;
+            pending_request.timeout = std::min(pending_request.timeout * 2, MAX_RTO);
+            pending_request.sent_again = true;
         }
-        LOG(DEBUG) << "Request timeout exceeded, retry";
-        // else loop again
     }
-    return 0;
+
+    request.used = false;
+    free_handles.push_back(handle);
+    return request.received_bytes;
+}
+
+void UDPNetwork::updateRTO(int64_t rtt) {
+    if (!rtt_measured) {
+        srtt = rtt;
+        rttvar = rtt / 2;
+        rtt_measured = true;
+    } else {
+        rttvar = (3 * rttvar + std::abs(srtt - rtt)) / 4;
+        srtt = (7 * srtt + rtt) / 8;
+    }
+    rto = std::max(MIN_RTO, std::min(MAX_RTO, srtt + 4 * rttvar));
+}
+
+bool UDPNetwork::receiveAnswer(int fd, int flags) {
+    char buffer[MAX_MESSAGE_SIZE];
+    IPAddress sender;
+    socklen_t sender_len = sizeof(sender);
+    ssize_t received_bytes = recvfrom(fd, buffer, sizeof(buffer), flags, (sockaddr *)&sender, &sender_len);
+    if (received_bytes == -1) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            LOG(ERROR) << "Could not receive answer from server";
+            LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+        }
+        return false;
+    }
+
+    if ((size_t)received_bytes < sizeof(Message)) {
+        return true;
+    }
+    // group messages have a sequence number of their own, which the requests waiting for them know
+    unsigned int sequence_number = ((Message *)buffer)->getSequenceNumber();
+    bool from_group = fd == group_fd;
+    for (PendingRequest &pending_request : pending) {
+        bool matches = from_group ? pending_request.group_answer &&
+                                        pending_request.group_sequence_number == sequence_number
+                                  : pending_request.sequence_number == sequence_number;
+        if (pending_request.used && pending_request.received_bytes < 0 && matches) {
+            pending_request.received_bytes = std::min((size_t)received_bytes, pending_request.reslen);
+            memcpy(pending_request.res, buffer, pending_request.received_bytes);
+            if (!pending_request.sent_again && !pending_request.waits_for_others) {
+                updateRTO(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                                               pending_request.sent_at)
+                              .count());
+            }
+            break;
+        }
+    }
+    return true;
 }
 
 ssize_t UDPNetwork::receive(Client &client, void *req, size_t reqlen) {
@@ -95,15 +277,115 @@ ssize_t UDPNetwork::receive(Client &client, void *req, size_t reqlen) {
         return -1;
     }
 
-    socklen_t size_of_client = sizeof(client);
+#ifdef USE_IO_URING
+    if (receive_ring != nullptr) {
+        ssize_t length;
+        return receiveBatchURing(&client, req, reqlen, &length, 1) == 1 ? length : -1;
+    }
+#endif
 
-    // recvfrom, blocks until a message arrives
-    ssize_t received_bytes = recvfrom(socket_fd, req, reqlen, 0, (sockaddr *)&client, &size_of_client);
-    if (received_bytes == -1) {
-        LOG(ERROR) << "Could not receive answer from client";
-        LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+    while (true) {
+        socklen_t size_of_client = sizeof(client);
+
+        // recvfrom, blocks until a message arrives
+        ssize_t received_bytes = recvfrom(socket_fd, req, reqlen, 0, (sockaddr *)&client, &size_of_client);
+        if (received_bytes == -1) {
+            LOG(ERROR) << "Could not receive answer from client";
+            LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+        }
+        if (!isRepeatedRequest(client, req, received_bytes)) {
+            return received_bytes;
+        }
     }
-    return received_bytes;
+}
+
+int UDPNetwork::receiveBatch(Client *clients, void *reqs, size_t reqlen, ssize_t *lengths, int count) {
+    if (socket_fd == -1) {
+        LOG(ERROR) << "No socket exists";
+        return -1;
+    }
+
+#ifdef USE_IO_URING
+    if (receive_ring != nullptr) {
+        return receiveBatchURing(clients, reqs, reqlen, lengths, count);
+    }
+#endif
+
+    receive_headers.resize(count);
+    receive_iovecs.resize(count);
+    while (true) {
+        for (int i = 0; i < count; i++) {
+            receive_iovecs[i].iov_base = (char *)reqs + i * reqlen;
+            receive_iovecs[i].iov_len = reqlen;
+            bzero(&receive_headers[i], sizeof(mmsghdr));
+            receive_headers[i].msg_hdr.msg_name = &clients[i];
+            receive_headers[i].msg_hdr.msg_namelen = sizeof(Client);
+            receive_headers[i].msg_hdr.msg_iov = &receive_iovecs[i];
+            receive_headers[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        // blocks until a message arrives, then takes all which are already there
+        int received = recvmmsg(socket_fd, receive_headers.data(), count, MSG_WAITFORONE, NULL);
+        if (received == -1) {
+            LOG(ERROR) << "Could not receive messages from clients";
+            LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+            return -1;
+        }
+
+        // move the messages which have to be handled to the front
+        int kept = 0;
+        for (int i = 0; i < received; i++) {
+            char *req = (char *)reqs + i * reqlen;
+            ssize_t received_bytes = receive_headers[i].msg_len;
+            if (isRepeatedRequest(clients[i], req, received_bytes)) {
+                continue;
+            }
+            if (kept != i) {
+                memcpy((char *)reqs + kept * reqlen, req, received_bytes);
+                clients[kept] = clients[i];
+            }
+            lengths[kept] = received_bytes;
+            kept++;
+        }
+        if (kept > 0) {
+            return kept;
+        }
+    }
+}
+
+bool UDPNetwork::isRepeatedRequest(const Client &client, void *req, ssize_t reqlen) {
+    if (reqlen < (ssize_t)sizeof(Message) || !((Message *)req)->isRequest()) {
+        return false;
+    }
+
+    // a request sent again, because the client did not get the answer (yet)
+    unsigned int sequence_number = ((Message *)req)->getSequenceNumber();
+    std::lock_guard<std::mutex> lock(windows_mutex);
+    WindowEntry &entry = windows[client].entries[sequence_number % REPLY_WINDOW];
+    if (entry.state != request_state_t::empty && entry.sequence_number == sequence_number) {
+        if (entry.state == request_state_t::answered) {
+            sendto(socket_fd, entry.reply, entry.reply_length, 0, (const sockaddr *)&client, sizeof(client));
+        }
+        return true;
+    }
+
+    // the request replaces the one REPLY_WINDOW sequence numbers before, which is not sent again anymore
+    entry.state = request_state_t::in_progress;
+    entry.sequence_number = sequence_number;
+    return false;
+}
+
+void UDPNetwork::rememberReply(const Client &client, void *res, size_t reslen) {
+    if (reslen < sizeof(Message) || reslen > MAX_MESSAGE_SIZE) {
+        return;
+    }
+    unsigned int sequence_number = ((Message *)res)->getSequenceNumber();
+    std::lock_guard<std::mutex> lock(windows_mutex);
+    WindowEntry &entry = windows[client].entries[sequence_number % REPLY_WINDOW];
+    entry.state = request_state_t::answered;
+    entry.sequence_number = sequence_number;
+    entry.reply_length = reslen;
+    memcpy(entry.reply, res, reslen);
 }
 
 ssize_t UDPNetwork::reply(const Client &client, void *res, size_t reslen) {
@@ -112,6 +394,9 @@ ssize_t UDPNetwork::reply(const Client &client, void *res, size_t reslen) {
         return -1;
     }
 
+    // keep the reply, in case the request is sent again
+    rememberReply(client, res, reslen);
+
     // sendto
     ssize_t send_bytes = sendto(socket_fd, res, reslen, 0, (sockaddr *)&client, sizeof(client));
     if (send_bytes == -1) {
@@ -120,3 +405,242 @@ ssize_t UDPNetwork::reply(const Client &client, void *res, size_t reslen) {
     }
     return send_bytes;
 }
+
+ssize_t UDPNetwork::queueReply(const Client &client, void *res, size_t reslen) {
+    rememberReply(client, res, reslen);
+
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    queued_clients.push_back(client);
+    queued_offsets.push_back(queued_data.size());
+    queued_lengths.push_back(reslen);
+    queued_data.insert(queued_data.end(), (char *)res, (char *)res + reslen);
+    return reslen;
+}
+
+void UDPNetwork::flush() {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    size_t count = queued_clients.size();
+    if (count == 0) {
+        return;
+    }
+
+    // the queued data does not move anymore, so the headers can point into it
+    send_headers.resize(std::max(send_headers.size(), count));
+    send_iovecs.resize(std::max(send_iovecs.size(), count));
+    for (size_t i = 0; i < count; i++) {
+        send_iovecs[i].iov_base = &queued_data[queued_offsets[i]];
+        send_iovecs[i].iov_len = queued_lengths[i];
+        bzero(&send_headers[i], sizeof(mmsghdr));
+        send_headers[i].msg_hdr.msg_name = &queued_clients[i];
+        send_headers[i].msg_hdr.msg_namelen = sizeof(IPAddress);
+        send_headers[i].msg_hdr.msg_iov = &send_iovecs[i];
+        send_headers[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    size_t sent = 0;
+#ifdef USE_IO_URING
+    if (send_ring != nullptr) {
+        sent = flushURing(count);
+    }
+#endif
+    while (sent < count) {
+        int result = sendmmsg(socket_fd, &send_headers[sent], count - sent, 0);
+        if (result == -1) {
+            LOG(ERROR) << "Could not send messages to clients";
+            LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+            break;
+        }
+        sent += result;
+    }
+
+    queued_clients.clear();
+    queued_offsets.clear();
+    queued_lengths.clear();
+    queued_data.clear();
+}
+
+bool UDPNetwork::joinGroup(const IPAddress &group) {
+    if (group_fd != -1) {
+        LOG(WARN) << "The network already joined a group";
+        return false;
+    }
+    group_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (group_fd == -1) {
+        LOG(ERROR) << "Socket could not be created (" << group_fd << ")";
+        LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+        return false;
+    }
+
+    // all clients on a host bind the port of the group, binding the group address keeps other datagrams out
+    int optval = 1;
+    setsockopt(group_fd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+    ip_mreq membership;
+    bzero(&membership, sizeof(membership));
+    membership.imr_multiaddr = group.sin_addr;
+    membership.imr_interface.s_addr = INADDR_ANY;
+    if (bind(group_fd, (const sockaddr *)&group, sizeof(group)) == -1 ||
+        setsockopt(group_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) == -1) {
+        LOG(ERROR) << "Could not join the multicast group " << group.getAddr() << ":" << group.getPort();
+        LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+        close(group_fd);
+        group_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+ssize_t UDPNetwork::queueGroupReply(const Client &client, void *res, size_t reslen) {
+    rememberReply(client, res, reslen);
+    return reslen;
+}
+
+ssize_t UDPNetwork::sendGroup(const IPAddress &group, void *msg, size_t msglen) {
+    if (socket_fd == -1) {
+        LOG(ERROR) << "No socket exists";
+        return -1;
+    }
+
+    ssize_t send_bytes = sendto(socket_fd, msg, msglen, 0, (const sockaddr *)&group, sizeof(group));
+    if (send_bytes == -1) {
+        LOG(ERROR) << "Could not send message to the multicast group";
+        LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+    }
+    return send_bytes;
+}
+
+short UDPNetwork::getPort() {
+    IPAddress address;
+    socklen_t address_len = sizeof(address);
+    if (socket_fd == -1 || getsockname(socket_fd, (sockaddr *)&address, &address_len) == -1) {
+        return 0;
+    }
+    return address.getPort();
+}
+
+#ifdef USE_IO_URING
+void UDPNetwork::setupURing() {
+    // every buffer holds the header of the receive, the address of the sender and the message
+    size_t buffer_size = sizeof(io_uring_recvmsg_out) + sizeof(IPAddress) + MAX_MESSAGE_SIZE;
+    receive_ring = new IOURing(URING_ENTRIES);
+    send_ring = new IOURing(URING_ENTRIES);
+    if (!receive_ring->isValid() || !send_ring->isValid() ||
+        !receive_ring->provideBuffers(RECEIVE_BUFFER_GROUP, URING_ENTRIES, buffer_size)) {
+        LOG(WARN) << "io_uring is not available, using system calls for every operation";
+        delete receive_ring;
+        delete send_ring;
+        receive_ring = nullptr;
+        send_ring = nullptr;
+        return;
+    }
+    bzero(&receive_template, sizeof(receive_template));
+    receive_template.msg_namelen = sizeof(IPAddress);
+}
+
+int UDPNetwork::receiveBatchURing(Client *clients, void *reqs, size_t reqlen, ssize_t *lengths, int count) {
+    int received = 0;
+    while (received == 0) {
+        // the multishot receive ends e.g. if it ran out of buffers, then it is armed again
+        if (!receive_armed) {
+            io_uring_sqe *sqe = receive_ring->getSQE();
+            sqe->opcode = IORING_OP_RECVMSG;
+            sqe->fd = socket_fd;
+            sqe->addr = (uint64_t)(uintptr_t)&receive_template;
+            sqe->len = 1;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = RECEIVE_BUFFER_GROUP;
+            receive_armed = true;
+        }
+
+        // blocks until a message arrives, the thread may be cancelled meanwhile
+        io_uring_cqe *cqe = receive_ring->peekCQE();
+        if (cqe == nullptr) {
+            receive_ring->submit(1, RECEIVE_WAIT);
+            pthread_testcancel();
+            continue;
+        }
+
+        // then takes all which are already there
+        for (; cqe != nullptr && received < count; cqe = receive_ring->peekCQE()) {
+            if ((cqe->flags & IORING_CQE_F_MORE) == 0) {
+                receive_armed = false;
+            }
+            if (cqe->res == -EINVAL) {
+                // the kernel does not know multishot receives, the system calls are used from now on
+                LOG(WARN) << "Multishot receive is not supported, using system calls";
+                receive_ring->seenCQE();
+                delete receive_ring;
+                receive_ring = nullptr;
+                return received > 0 ? received : receiveBatch(clients, reqs, reqlen, lengths, count);
+            }
+            if (cqe->res < 0 && cqe->res != -ENOBUFS) {
+                LOG(ERROR) << "Could not receive messages from clients";
+                LOG(ERROR) << "Error: " << -cqe->res << " - " << strerror(-cqe->res);
+            }
+            if (cqe->res < 0 || (cqe->flags & IORING_CQE_F_BUFFER) == 0) {
+                receive_ring->seenCQE();
+                continue;
+            }
+
+            unsigned short buffer_id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+            char *buffer = receive_ring->getBuffer(buffer_id);
+            io_uring_recvmsg_out *header = (io_uring_recvmsg_out *)buffer;
+            char *name = buffer + sizeof(io_uring_recvmsg_out);
+            char *payload = name + receive_template.msg_namelen;
+            size_t available = (size_t)cqe->res - (payload - buffer);
+            size_t received_bytes = std::min(std::min((size_t)header->payloadlen, available), reqlen);
+
+            char *req = (char *)reqs + received * reqlen;
+            memcpy(req, payload, received_bytes);
+            bzero(&clients[received], sizeof(Client));
+            memcpy(&clients[received], name, std::min((size_t)header->namelen, sizeof(Client)));
+            receive_ring->recycleBuffer(buffer_id);
+            receive_ring->seenCQE();
+
+            if (!isRepeatedRequest(clients[received], req, received_bytes)) {
+                lengths[received] = received_bytes;
+                received++;
+            }
+        }
+    }
+    return received;
+}
+
+size_t UDPNetwork::flushURing(size_t count) {
+    size_t sent = 0;
+    while (sent < count) {
+        // as many replies as fit into the ring are submitted with a single system call
+        unsigned batch = 0;
+        io_uring_sqe *sqe;
+        while (sent + batch < count && (sqe = send_ring->getSQE()) != nullptr) {
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = socket_fd;
+            sqe->addr = (uint64_t)(uintptr_t)&send_headers[sent + batch].msg_hdr;
+            sqe->len = 1;
+            batch++;
+        }
+
+        // the queued data must stay until all replies were sent
+        unsigned completed = 0;
+        while (completed < batch) {
+            io_uring_cqe *cqe = send_ring->peekCQE();
+            if (cqe == nullptr) {
+                if (send_ring->submit(batch - completed) < 0 && errno != EINTR && errno != EAGAIN) {
+                    LOG(ERROR) << "Could not submit replies to clients";
+                    LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+                    return sent;
+                }
+                continue;
+            }
+            if (cqe->res < 0) {
+                LOG(ERROR) << "Could not send message to client";
+                LOG(ERROR) << "Error: " << -cqe->res << " - " << strerror(-cqe->res);
+            }
+            send_ring->seenCQE();
+            completed++;
+        }
+        sent += batch;
+    }
+    return sent;
+}
+#endif
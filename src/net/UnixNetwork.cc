@@ -0,0 +1,640 @@
+#include <algorithm>
+#include <climits>
+#include <fcntl.h>
+#include <poll.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "misc/Log.h"
+#include "net/UnixNetwork.h"
+
+static const char *NAME_PREFIX = "gameoflife-";
+static const unsigned short FIRST_FREE_PORT = 32768;
+static const unsigned short LAST_FREE_PORT = 60999;
+static const int FULL_SOCKET_WAIT = 1; // milliseconds answers are received, before a full socket is tried again
+
+struct BoundSocket {
+    int fd;
+    int type;
+    int users;
+};
+
+static std::mutex bound_sockets_mutex;
+static std::map<unsigned short, BoundSocket> bound_sockets; // sockets of the ports of this process
+
+/**
+ * Gets the abstract socket name of a port, it starts with a zero byte and does not exist in the file system.
+ *
+ * @return the length of the address
+ */
+static socklen_t socketAddress(unsigned short port, sockaddr_un &address) {
+    bzero(&address, sizeof(address));
+    address.sun_family = AF_UNIX;
+    snprintf(address.sun_path + 1, sizeof(address.sun_path) - 1, "%s%u", NAME_PREFIX, port);
+    return offsetof(sockaddr_un, sun_path) + 1 + strlen(address.sun_path + 1);
+}
+
+/**
+ * Gets the address of the port a socket name belongs to.
+ *
+ * @return false, if the name is not the one of a port
+ */
+static bool portAddress(const sockaddr_un &address, socklen_t length, IPAddress &client) {
+    size_t prefix_length = strlen(NAME_PREFIX);
+    size_t name_start = offsetof(sockaddr_un, sun_path) + 1;
+    size_t name_length = length > name_start ? length - name_start : 0;
+    if (name_length <= prefix_length || address.sun_path[0] != '\0' ||
+        strncmp(address.sun_path + 1, NAME_PREFIX, prefix_length) != 0) {
+        return false;
+    }
+    std::string port(address.sun_path + 1 + prefix_length, name_length - prefix_length);
+    bzero(&client, sizeof(client));
+    client.sin_family = AF_INET;
+    client.setAddr(INADDR_LOOPBACK);
+    client.setPort((short)strtoul(port.c_str(), nullptr, 10));
+    return true;
+}
+
+/**
+ * Binds a socket to the name of a port, port 0 chooses a free one, which is returned in port.
+ */
+static bool bindPort(int fd, unsigned short &port) {
+    sockaddr_un address;
+    if (port != 0) {
+        return bind(fd, (const sockaddr *)&address, socketAddress(port, address)) == 0;
+    }
+
+    // start at a different port in every process, so that clients starting together rarely collide
+    int range = LAST_FREE_PORT - FIRST_FREE_PORT + 1;
+    for (int i = 0; i < range; i++) {
+        unsigned short candidate = FIRST_FREE_PORT + (getpid() + i) % range;
+        if (bind(fd, (const sockaddr *)&address, socketAddress(candidate, address)) == 0) {
+            port = candidate;
+            return true;
+        }
+        if (errno != EADDRINUSE) {
+            return false;
+        }
+    }
+    return false;
+}
+
+/**
+ * Opens the socket of a port, if the process does not have it yet. Stream sockets listen for connections.
+ *
+ * @return the socket, or -1 on error
+ */
+static int attachSocket(unsigned short &port, int type) {
+    std::lock_guard<std::mutex> lock(bound_sockets_mutex);
+    auto search = port != 0 ? bound_sockets.find(port) : bound_sockets.end();
+    if (search != bound_sockets.end() && search->second.type == type) {
+        search->second.users++;
+        return search->second.fd;
+    }
+
+    int fd = socket(AF_UNIX, type, 0);
+    if (fd == -1) {
+        return -1;
+    }
+    if (!bindPort(fd, port) || (type == SOCK_SEQPACKET && listen(fd, SOMAXCONN) != 0)) {
+        close(fd);
+        return -1;
+    }
+
+    // the listen socket is edge-triggered, so all pending connections are accepted at once until none is left
+    if (type == SOCK_SEQPACKET) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    }
+    bound_sockets[port] = BoundSocket{fd, type, 1};
+    return fd;
+}
+
+static void detachSocket(unsigned short port) {
+    std::lock_guard<std::mutex> lock(bound_sockets_mutex);
+    auto search = bound_sockets.find(port);
+    if (search == bound_sockets.end() || --search->second.users > 0) {
+        return;
+    }
+    close(search->second.fd);
+    bound_sockets.erase(search);
+}
+
+UnixNetwork::UnixNetwork(short port, bool stream) : type(stream ? SOCK_SEQPACKET : SOCK_DGRAM), port(port) {
+    socket_fd = attachSocket(this->port, type);
+    if (socket_fd == -1) {
+        LOG(ERROR) << "Socket for port " << port << " could not be created";
+        LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+        this->port = 0;
+        return;
+    }
+
+    if (stream) {
+        epoll_fd = epoll_create1(0);
+        epoll_event event;
+        event.events = EPOLLIN | EPOLLET;
+        event.data.fd = socket_fd;
+        if (epoll_fd == -1 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, socket_fd, &event) != 0) {
+            LOG(ERROR) << "Could not monitor the listen socket";
+            LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+        }
+    }
+}
+
+UnixNetwork::UnixNetwork(bool stream) : type(stream ? SOCK_SEQPACKET : SOCK_DGRAM) {
+    // a stream client binds every connection to a port of its own instead
+    if (!stream) {
+        socket_fd = attachSocket(port, type);
+        if (socket_fd == -1) {
+            LOG(ERROR) << "Socket could not be created";
+            LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+        }
+    }
+}
+
+UnixNetwork::~UnixNetwork() {
+    if (epoll_fd != -1) {
+        close(epoll_fd);
+    }
+    for (auto elem : sockets) {
+        close(elem.first);
+    }
+    if (socket_fd != -1) {
+        detachSocket(port);
+    }
+}
+
+ssize_t UnixNetwork::request(const Server &server, void *req, size_t reqlen, void *res, size_t reslen, int timeout) {
+    // clear buffer !!!
+    bzero(res, reslen);
+
+    return wait(submit(server, req, reqlen, res, reslen), timeout);
+}
+
+int UnixNetwork::submit(const Server &server, void *req, size_t reqlen, void *res, size_t reslen) {
+    if (type == SOCK_DGRAM && socket_fd == -1) {
+        LOG(ERROR) << "No socket exists";
+        return -1;
+    }
+
+    if (reqlen > MAX_MESSAGE_SIZE) {
+        LOG(ERROR) << "Request of " << reqlen << " bytes does not fit into a message";
+        return -1;
+    }
+
+    // entries are reused, so that only the first requests in flight allocate memory
+    int handle;
+    if (free_handles.empty()) {
+        handle = (int)pending.size();
+        pending.emplace_back();
+    } else {
+        handle = free_handles.back();
+        free_handles.pop_back();
+    }
+    PendingRequest &pending_request = pending[handle];
+    pending_request.used = true;
+    pending_request.server = server;
+    memcpy(pending_request.request, req, reqlen);
+    pending_request.request_length = reqlen;
+    pending_request.sequence_number = ((Message *)req)->getSequenceNumber();
+    pending_request.res = res;
+    pending_request.reslen = reslen;
+    pending_request.received_bytes = -1;
+    pending_request.sent = sendRequest(pending_request);
+    return handle;
+}
+
+bool UnixNetwork::sendRequest(PendingRequest &request) {
+    if (type == SOCK_SEQPACKET) {
+        int connection_fd = getConnection(request.server);
+        if (connection_fd == -1) {
+            return false;
+        }
+        if (send(connection_fd, request.request, request.request_length, MSG_NOSIGNAL) == -1) {
+            LOG(ERROR) << "Could not send a request to the server";
+            LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+        }
+        return true;
+    }
+
+    // the server may be waiting for answers to be taken from this socket, so they are received meanwhile
+    sockaddr_un address;
+    socklen_t address_length = socketAddress(request.server.getPort(), address);
+    while (sendto(socket_fd, request.request, request.request_length, MSG_DONTWAIT, (const sockaddr *)&address,
+                  address_length) == -1) {
+        if (errno == ECONNREFUSED || errno == ENOENT) {
+            return false;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            LOG(ERROR) << "Could not send a request to the server";
+            LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+            return true;
+        }
+        receiveAnswers(FULL_SOCKET_WAIT);
+    }
+    return true;
+}
+
+bool UnixNetwork::sendPending() {
+    bool all_sent = true;
+    for (PendingRequest &pending_request : pending) {
+        if (pending_request.used && !pending_request.sent) {
+            pending_request.sent = sendRequest(pending_request);
+            all_sent = all_sent && pending_request.sent;
+        }
+    }
+    return all_sent;
+}
+
+void UnixNetwork::receiveAnswers(int wait_time) {
+    poll_fds.clear();
+    if (type == SOCK_DGRAM) {
+        poll_fds.push_back(pollfd{socket_fd, POLLIN, 0});
+    } else {
+        for (auto &elem : sockets) {
+            poll_fds.push_back(pollfd{elem.first, POLLIN, 0});
+        }
+    }
+    if (poll_fds.empty() || ::poll(poll_fds.data(), poll_fds.size(), wait_time) <= 0) {
+        return;
+    }
+
+    char buffer[MAX_MESSAGE_SIZE];
+    for (pollfd &fd : poll_fds) {
+        if (fd.revents == 0) {
+            continue;
+        }
+        ssize_t received_bytes;
+        while ((received_bytes = recv(fd.fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+            storeAnswer(buffer, received_bytes);
+        }
+        if (received_bytes == 0 && type == SOCK_SEQPACKET) {
+            LOG(ERROR) << "Connection to the server was closed";
+            closeConnection(fd.fd);
+        }
+    }
+}
+
+void UnixNetwork::storeAnswer(char *buffer, ssize_t received_bytes) {
+    if ((size_t)received_bytes < sizeof(Message)) {
+        return;
+    }
+    unsigned int sequence_number = ((Message *)buffer)->getSequenceNumber();
+    for (PendingRequest &pending_request : pending) {
+        if (pending_request.used && pending_request.received_bytes < 0 &&
+            pending_request.sequence_number == sequence_number) {
+            pending_request.received_bytes = std::min((size_t)received_bytes, pending_request.reslen);
+            memcpy(pending_request.res, buffer, pending_request.received_bytes);
+            break;
+        }
+    }
+}
+
+bool UnixNetwork::poll(int handle) {
+    receiveAnswers(0);
+    return handle >= 0 && (size_t)handle < pending.size() && pending[handle].used &&
+           pending[handle].received_bytes >= 0;
+}
+
+ssize_t UnixNetwork::wait(int handle, int timeout) {
+    return waitUntil(handle, timeout, std::chrono::steady_clock::time_point::max());
+}
+
+ssize_t UnixNetwork::waitFor(int handle, int limit) {
+    return waitUntil(handle, 1, std::chrono::steady_clock::now() + std::chrono::milliseconds(limit));
+}
+
+ssize_t UnixNetwork::waitUntil(int handle, int timeout, std::chrono::steady_clock::time_point deadline) {
+    if (handle < 0 || (size_t)handle >= pending.size() || !pending[handle].used) {
+        return -1;
+    }
+    PendingRequest &request = pending[handle];
+
+    // sent requests are answered for sure, the others are sent again after the timeout
+    while (request.received_bytes < 0) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            break;
+        }
+        bool all_sent = sendPending();
+        if (!all_sent) {
+            LOG(INFO) << "Server does not exist, waiting...";
+        }
+        int wait_time = all_sent ? -1 : std::max(timeout, 1) * 1000;
+        int64_t remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+        if (remaining < INT_MAX && (wait_time < 0 || remaining < wait_time)) {
+            wait_time = (int)remaining;
+        }
+        receiveAnswers(wait_time);
+    }
+
+    request.used = false;
+    free_handles.push_back(handle);
+    return request.received_bytes;
+}
+
+ssize_t UnixNetwork::receive(Client &client, void *req, size_t reqlen) {
+    if (socket_fd == -1) {
+        LOG(ERROR) << "No socket exists";
+        return -1;
+    }
+
+    if (type == SOCK_DGRAM) {
+        ssize_t length;
+        int count = receiveBatch(&client, req, reqlen, &length, 1);
+        return count == 1 ? length : -1;
+    }
+
+    while (true) {
+        // wait for sockets to become ready, only if no socket is left over from the last wait
+        if (ready_head == ready.size()) {
+            ready.clear();
+            ready_head = 0;
+            epoll_event events[EPOLL_MAX_EVENTS];
+            int event_count = epoll_wait(epoll_fd, events, EPOLL_MAX_EVENTS, -1);
+            if (event_count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                LOG(ERROR) << "Could not monitor socket descriptors";
+                LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+                return -1;
+            }
+            for (int i = 0; i < event_count; i++) {
+                ready.push_back(events[i].data.fd);
+            }
+        }
+
+        int connection_fd = ready[ready_head++];
+
+        // sockets with more requests are queued again, drop the handled ones before the queue keeps growing
+        if (ready_head >= (size_t)EPOLL_MAX_EVENTS && ready_head * 2 >= ready.size()) {
+            ready.erase(ready.begin(), ready.begin() + ready_head);
+            ready_head = 0;
+        }
+
+        if (connection_fd == socket_fd) {
+            acceptConnections();
+            continue;
+        }
+
+        // the socket stays ready until a receive would block, there is no new event before
+        ssize_t received_bytes = recv(connection_fd, req, reqlen, MSG_DONTWAIT);
+        if (received_bytes == 0) {
+            closeConnection(connection_fd);
+            continue;
+        }
+        if (received_bytes < 0) {
+            if (errno == EINTR) {
+                ready.push_back(connection_fd);
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                // e.g. the connection of a client which crashed was reset
+                closeConnection(connection_fd);
+            }
+            continue;
+        }
+
+        // check the socket again later, if it holds more requests or was closed
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        auto search = sockets.find(connection_fd);
+        if (search == sockets.end()) {
+            continue;
+        }
+        ready.push_back(connection_fd);
+        client = search->second;
+        return received_bytes;
+    }
+}
+
+int UnixNetwork::receiveBatch(Client *clients, void *reqs, size_t reqlen, ssize_t *lengths, int count) {
+    if (type == SOCK_SEQPACKET) {
+        return IPNetwork::receiveBatch(clients, reqs, reqlen, lengths, count);
+    }
+    if (socket_fd == -1) {
+        LOG(ERROR) << "No socket exists";
+        return -1;
+    }
+
+    receive_headers.resize(count);
+    receive_iovecs.resize(count);
+    receive_addresses.resize(count);
+    while (true) {
+        for (int i = 0; i < count; i++) {
+            receive_iovecs[i].iov_base = (char *)reqs + i * reqlen;
+            receive_iovecs[i].iov_len = reqlen;
+            bzero(&receive_headers[i], sizeof(mmsghdr));
+            receive_headers[i].msg_hdr.msg_name = &receive_addresses[i];
+            receive_headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_un);
+            receive_headers[i].msg_hdr.msg_iov = &receive_iovecs[i];
+            receive_headers[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        // blocks until a message arrives, then takes all which are already there
+        int received = recvmmsg(socket_fd, receive_headers.data(), count, MSG_WAITFORONE, NULL);
+        if (received == -1) {
+            LOG(ERROR) << "Could not receive messages from clients";
+            LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+            return -1;
+        }
+
+        // messages of unbound sockets can not be answered, they are dropped
+        int kept = 0;
+        for (int i = 0; i < received; i++) {
+            char *req = (char *)reqs + i * reqlen;
+            ssize_t received_bytes = receive_headers[i].msg_len;
+            if (!portAddress(receive_addresses[i], receive_headers[i].msg_hdr.msg_namelen, clients[kept])) {
+                continue;
+            }
+            if (kept != i) {
+                memcpy((char *)reqs + kept * reqlen, req, received_bytes);
+            }
+            lengths[kept] = received_bytes;
+            kept++;
+        }
+        if (kept > 0) {
+            return kept;
+        }
+    }
+}
+
+void UnixNetwork::acceptConnections() {
+    while (true) {
+        sockaddr_un address;
+        socklen_t address_length = sizeof(address);
+        int connection_fd = accept(socket_fd, (sockaddr *)&address, &address_length);
+        if (connection_fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                LOG(ERROR) << "Could not accept connection from client";
+                LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+            }
+            return;
+        }
+
+        // the client is known by the port its connection is bound to
+        IPAddress client;
+        if (!portAddress(address, address_length, client)) {
+            close(connection_fd);
+            continue;
+        }
+
+        epoll_event event;
+        event.events = EPOLLIN | EPOLLET;
+        event.data.fd = connection_fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, connection_fd, &event) != 0) {
+            LOG(ERROR) << "Could not monitor connection to client";
+            close(connection_fd);
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex);
+            connections[client] = connection_fd;
+            sockets[connection_fd] = client;
+        }
+
+        // the request may have arrived before the socket was monitored
+        ready.push_back(connection_fd);
+    }
+}
+
+int UnixNetwork::getConnection(const Server &server) {
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        auto search = connections.find(server);
+        if (search != connections.end()) {
+            return search->second;
+        }
+    }
+
+    // the connection is bound to a port, so that the server can tell the clients apart
+    int connection_fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    unsigned short local_port = 0;
+    if (connection_fd == -1 || !bindPort(connection_fd, local_port)) {
+        LOG(ERROR) << "Could not create socket";
+        LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+        if (connection_fd != -1) {
+            close(connection_fd);
+        }
+        return -1;
+    }
+
+    sockaddr_un address;
+    socklen_t address_length = socketAddress(server.getPort(), address);
+    if (connect(connection_fd, (const sockaddr *)&address, address_length) != 0) {
+        if (errno != ECONNREFUSED && errno != ENOENT) {
+            LOG(ERROR) << "Could not connect to the server";
+            LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+        }
+        close(connection_fd);
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(connections_mutex);
+    connections[server] = connection_fd;
+    sockets[connection_fd] = server;
+    return connection_fd;
+}
+
+void UnixNetwork::closeConnection(int connection_fd) {
+    std::lock_guard<std::mutex> lock(connections_mutex);
+    if (epoll_fd != -1) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, connection_fd, NULL);
+    }
+    close(connection_fd);
+    ready.erase(std::remove(ready.begin() + ready_head, ready.end(), connection_fd), ready.end());
+    auto search = sockets.find(connection_fd);
+    if (search == sockets.end()) {
+        return;
+    }
+
+    // the answers of the server will not come anymore
+    for (PendingRequest &pending_request : pending) {
+        if (pending_request.used && pending_request.sent && pending_request.received_bytes < 0 &&
+            pending_request.server == search->second) {
+            pending_request.received_bytes = 0;
+        }
+    }
+    connections.erase(search->second);
+    sockets.erase(search);
+}
+
+ssize_t UnixNetwork::reply(const Client &client, void *res, size_t reslen) {
+    ssize_t send_bytes;
+    if (type == SOCK_SEQPACKET) {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        auto search = connections.find(client);
+        if (search == connections.end()) {
+            LOG(ERROR) << "Given client is not known";
+            return -1;
+        }
+        send_bytes = send(search->second, res, reslen, MSG_NOSIGNAL);
+    } else {
+        sockaddr_un address;
+        socklen_t address_length = socketAddress(client.getPort(), address);
+        send_bytes = sendto(socket_fd, res, reslen, 0, (const sockaddr *)&address, address_length);
+    }
+    if (send_bytes == -1) {
+        LOG(ERROR) << "Could not send message to client";
+        LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+    }
+    return send_bytes;
+}
+
+ssize_t UnixNetwork::queueReply(const Client &client, void *res, size_t reslen) {
+    if (type == SOCK_SEQPACKET) {
+        return reply(client, res, reslen);
+    }
+
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    queued_addresses.emplace_back();
+    queued_address_lengths.push_back(socketAddress(client.getPort(), queued_addresses.back()));
+    queued_offsets.push_back(queued_data.size());
+    queued_lengths.push_back(reslen);
+    queued_data.insert(queued_data.end(), (char *)res, (char *)res + reslen);
+    return reslen;
+}
+
+void UnixNetwork::flush() {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    size_t count = queued_addresses.size();
+    if (count == 0) {
+        return;
+    }
+
+    // the queued data does not move anymore, so the headers can point into it
+    send_headers.resize(std::max(send_headers.size(), count));
+    send_iovecs.resize(std::max(send_iovecs.size(), count));
+    for (size_t i = 0; i < count; i++) {
+        send_iovecs[i].iov_base = &queued_data[queued_offsets[i]];
+        send_iovecs[i].iov_len = queued_lengths[i];
+        bzero(&send_headers[i], sizeof(mmsghdr));
+        send_headers[i].msg_hdr.msg_name = &queued_addresses[i];
+        send_headers[i].msg_hdr.msg_namelen = queued_address_lengths[i];
+        send_headers[i].msg_hdr.msg_iov = &send_iovecs[i];
+        send_headers[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    size_t sent = 0;
+    while (sent < count) {
+        int result = sendmmsg(socket_fd, &send_headers[sent], count - sent, 0);
+        if (result == -1) {
+            // a client which exited already does not stop the replies to the others
+            LOG(ERROR) << "Could not send messages to clients";
+            LOG(ERROR) << "Error: " << errno << " - " << strerror(errno);
+            sent++;
+            continue;
+        }
+        sent += result;
+    }
+
+    queued_addresses.clear();
+    queued_address_lengths.clear();
+    queued_offsets.clear();
+    queued_lengths.clear();
+    queued_data.clear();
+}
+
+short UnixNetwork::getPort() { return socket_fd != -1 ? (short)port : 0; }